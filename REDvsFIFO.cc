@@ -23,6 +23,10 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -35,8 +39,25 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/flow-monitor-module.h"
 #include "ns3/callback.h"
-
-// Network Topology
+#ifdef NS3_MPI
+#include <mpi.h>
+#include "ns3/mpi-interface.h"
+#endif
+#include "trace-recorder.h"
+#include "queue-occupancy-tracer.h"
+#include "parallel-runner.h"
+#include "adaptive-sweep.h"
+#include "run-stats.h"
+#include "timer-wheel-scheduler.h"
+#include "profiling-scheduler.h"
+#include "live-metrics-publisher.h"
+#include "decimated-plot.h"
+#include "branch-runner.h"
+#include "replication-stats.h"
+#include "quantile-sketch.h"
+#include "flow-workload.h"
+
+// Network Topology (default --nFlows=5)
 //       N1    N6
 //        |    |
 // N2----+|    |+----N7
@@ -49,69 +70,177 @@
 
 using namespace ns3;
 
+// Inter-arrival times of the short-flow workload
 Ptr<ExponentialRandomVariable> uv = CreateObject<ExponentialRandomVariable> ();
 double stopTime = 20.0;
 
-void CheckQueueSize (Ptr<QueueDisc> queue)
-{
-  uint32_t qSize = queue->GetCurrentSize ().GetValue ();
+// Write the bottleneck queue length to queuered.plotme and the latency
+// quantiles of every flow to red-latency.plotme
+bool traceQueue = true;
 
-  // check queue size every 1/100 of a second
-  Simulator::Schedule (Seconds (0.001), &CheckQueueSize, queue);
+// Format of the per-change queue trace: text (queuered.plotme) or binary
+// (queuered.bintrace)
+std::string traceFormat = "text";
 
-  std::ofstream QSizeFile (std::stringstream ("queuered.plotme").str ().c_str (),   std::ios::out | std::ios::app);
-  QSizeFile << Simulator::Now ().GetSeconds () << " " << qSize << std::endl;
-  QSizeFile.close ();
-}
+// Parameters of one simulation run
+struct RedConfig
+{
+  std::string queueDiscType;
+  double minTh;
+  double maxTh;
+  double lInterm;
+  uint64_t run;
+};
+
+// Outcome of one simulation run
+struct RedResult
+{
+  double goodput;
+  double meanQueue;
+  uint64_t drops;
+  QuantileSketch rtt;           //!< RTT estimates of all senders (s)
+  QuantileSketch sojourn;       //!< time spent in the bottleneck queue disc (s)
+  uint64_t flowsStarted;        //!< short flows started
+  uint64_t flowsRejected;       //!< short flows not started: too many in progress, or no socket
+  uint64_t flowsFailed;         //!< short flows started whose connection failed or was aborted
+  QuantileSketch fct;           //!< short flow completion times (s)
+};
+
+// Number of sender/receiver leaf pairs
+uint32_t nFlows = 5;
+
+// Print build time, run time, events and peak RSS of every run
+bool printStats = false;
+
+// MPI rank of this process and number of ranks; with two ranks, rank 0
+// simulates R1 and the senders and rank 1 simulates R2 and the receivers
+uint32_t systemId = 0;
+uint32_t systemCount = 1;
+
+// Prefix of the live-metrics segment of every run; empty publishes nothing
+std::string live;
+double liveInterval = 0.1;
+
+// Interval of the min/max/mean queue length in queuered.plotme; 0 writes
+// every change of the queue length instead
+double queueInterval = 0;
+
+// Decimation of the queue length plotted into queuered.plt; empty writes
+// no plot
+std::string plotMethod;
+
+// Run a long-lived bulk flow on every sender/receiver pair
+bool bulk = true;
+
+// Short flows arriving per second between random leaves; 0 runs none.
+// Sizes are Pareto with mean flowSize bytes and shape flowShape, bounded
+// at 1000 times the mean.
+double flowRate = 0;
+double flowSize = 50000;
+double flowShape = 1.2;
+uint32_t maxActiveFlows = 10000;
 
 // Packet Sink Applications on destination nodes
-void InstallPacketSink (Ptr<Node> node, uint16_t port)
+Ptr<PacketSink> InstallPacketSink (Ptr<Node> node, uint16_t port)
 {
   PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
   ApplicationContainer sinkApps = sink.Install (node);
   sinkApps.Start (Seconds (0.0));
-  sinkApps.Stop (Seconds (20.0));
+  sinkApps.Stop (Seconds (stopTime));
+  return DynamicCast<PacketSink> (sinkApps.Get (0));
 }
 
 // Bulk Send Applications on source nodes
-void InstallBulkSend (Ptr<Node> node, Ipv4Address address, uint16_t port)
+Ptr<BulkSendApplication> InstallBulkSend (Ptr<Node> node, Ipv4Address address, uint16_t port, Time start)
 {
   BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (address, port));
   source.SetAttribute ("MaxBytes", UintegerValue (0));
   ApplicationContainer sourceApps = source.Install (node);
-
-  // Start each source application with an interval of 1 second
-  double i = 1.0;
-  sourceApps.Start (Seconds (10.0 + i));
-  i++;
+  sourceApps.Start (start);
   sourceApps.Stop (Seconds (stopTime));
+  return DynamicCast<BulkSendApplication> (sourceApps.Get (0));
 }
 
-// Main function
-int main (int argc, char *argv[])
+// Per-flow RTT estimates of the senders and sojourn times at the
+// bottleneck queue disc, in seconds
+struct LatencyProbe
 {
-  uint32_t stream = 1;
-  std::string transport_prot = "TcpNewReno";
-  std::string queue_disc_type = "RedQueueDisc";
+  std::vector<QuantileSketch> rtt;
+  std::vector<QuantileSketch> sojourn;
+};
 
-  CommandLine cmd;
-  cmd.AddValue ("stream", "Seed value for random variable", stream);
-  cmd.AddValue ("queue_disc_type", "Queue disc type for gateway (e.g. ns3::FifoQueueDisc or ns3::RedQueueDisc)", queue_disc_type);
-  cmd.AddValue ("stopTime", "Stop time for applications / simulation time will be stopTime", stopTime);
-  cmd.Parse (argc,argv);
+// Packet leaving the bottleneck; flow i is sent from 10.1.0.0 + 4 i + 1
+static void
+ProbeSojourn (LatencyProbe *probe, Ptr<const QueueDiscItem> item)
+{
+  Ptr<const Ipv4QueueDiscItem> ipv4Item = DynamicCast<const Ipv4QueueDiscItem> (item);
+  if (!ipv4Item)
+    {
+      return;
+    }
+  uint32_t flow = (ipv4Item->GetHeader ().GetSource ().Get () - Ipv4Address ("10.1.0.0").Get ()) / 4;
+  if (flow < probe->sojourn.size ())
+    {
+      probe->sojourn[flow].Add ((Simulator::Now () - item->GetTimeStamp ()).GetSeconds ());
+    }
+}
 
-  uv->SetStream (stream);
-  transport_prot = std::string ("ns3::") + transport_prot;
-  queue_disc_type = std::string ("ns3::") + queue_disc_type;
+// New RTT estimate of a sender, taken on every ACK
+static void
+ProbeRtt (QuantileSketch *sketch, Time oldRtt, Time newRtt)
+{
+  sketch->Add (newRtt.GetSeconds ());
+}
 
-  TypeId qdTid;
-  NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (queue_disc_type, &qdTid), "TypeId " << queue_disc_type << " not found");
+// The socket of a sender exists once it has started
+static void
+ConnectRtt (Ptr<BulkSendApplication> source, QuantileSketch *sketch)
+{
+  Ptr<Socket> socket = source->GetSocket ();
+  if (socket)
+    {
+      socket->TraceConnectWithoutContext ("RTT", MakeBoundCallback (&ProbeRtt, sketch));
+    }
+}
 
-  // Create nodes
+// p50, p99 and p99.9 of a sketch of seconds, in milliseconds
+static std::string
+Quantiles (const QuantileSketch &sketch)
+{
+  std::ostringstream oss;
+  oss << sketch.GetQuantile (0.5) * 1e3 << " " << sketch.GetQuantile (0.99) * 1e3
+      << " " << sketch.GetQuantile (0.999) * 1e3;
+  return oss.str ();
+}
+
+// Dumbbell built once and shared by the queue discs run on it
+struct RedTopology
+{
+  NetDeviceContainer r1r2ND;
+  bool ownLeft;
+  std::vector<Ptr<PacketSink> > sinks;
+  std::vector<Ptr<BulkSendApplication> > sources;
+  Ptr<FlowWorkload> workload;
+  double buildWall;
+};
+
+// Build the dumbbell and its applications; the bottleneck queue disc is
+// installed by RunOnTopology ()
+static void
+BuildTopology (RedTopology *topology)
+{
+  RunStats runStats;
+
+  // Create nodes.  Every rank builds the whole topology; the R1-R2 link
+  // becomes a remote channel when its ends belong to different ranks.
+  uint32_t rightSystem = systemCount > 1 ? 1 : 0;
+  bool ownLeft = (systemId == 0);
+  bool ownRight = (systemId == rightSystem);
   NodeContainer leftNodes, rightNodes, routers;
-  routers.Create (2);
-  leftNodes.Create (5);
-  rightNodes.Create (5);
+  routers.Add (CreateObject<Node> (0));
+  routers.Add (CreateObject<Node> (rightSystem));
+  leftNodes.Create (nFlows, 0);
+  rightNodes.Create (nFlows, rightSystem);
 
   // Create the point-to-point link helpers
   PointToPointHelper pointToPointRouter;
@@ -119,32 +248,9 @@ int main (int argc, char *argv[])
   pointToPointRouter.SetChannelAttribute ("Delay", StringValue ("10ms"));
   NetDeviceContainer r1r2ND = pointToPointRouter.Install (routers.Get (0), routers.Get (1));
 
-  // Separate Network device containers for left and right nodes
-  std::vector <NetDeviceContainer> leftToRouter;
-  std::vector <NetDeviceContainer> routerToRight;
   PointToPointHelper pointToPointLeaf;
   pointToPointLeaf.SetDeviceAttribute    ("DataRate", StringValue ("100Mbps"));
-
-  // Node 1
   pointToPointLeaf.SetChannelAttribute   ("Delay", StringValue ("1ms"));
-  leftToRouter.push_back (pointToPointLeaf.Install (leftNodes.Get (0), routers.Get (0)));
-  routerToRight.push_back (pointToPointLeaf.Install (routers.Get (1), rightNodes.Get (0)));
-
-  // Node 2
-  leftToRouter.push_back (pointToPointLeaf.Install (leftNodes.Get (1), routers.Get (0)));
-  routerToRight.push_back (pointToPointLeafstream.Install (routers.Get (1), rightNodes.Get (1)));
-
-  // Node 3
-  leftToRouter.push_back (pointToPointLeaf.Install (leftNodes.Get (2), routers.Get (0)));
-  routerToRight.push_back (pointToPointLeaf.Install (routers.Get (1), rightNodes.Get (2)));
-
-  // Node 4
-  leftToRouter.push_back (pointToPointLeaf.Install (leftNodes.Get (3), routers.Get (0)));
-  routerToRight.push_back (pointToPointLeaf.Install (routers.Get (1), rightNodes.Get (3)));
-
-  // Node 5
-  leftToRouter.push_back (pointToPointLeaf.Install (leftNodes.Get (4), routers.Get (0)));
-  routerToRight.push_back (pointToPointLeaf.Install (routers.Get (1), rightNodes.Get (4)));
 
   // Install Internet Stack on all nodes
   InternetStackHelper stack;
@@ -152,73 +258,680 @@ int main (int argc, char *argv[])
   stack.Install (leftNodes);
   stack.Install (rightNodes);
 
-  // Assign IP addresses
-  Ipv4AddressHelper ipAddresses ("10.0.0.0", "255.255.255.0");
-
-  Ipv4InterfaceContainer r1r2IPAddress = ipAddresses.Assign (r1r2ND);
-  ipAddresses.NewNetwork ();
-
-  std::vector <Ipv4InterfaceContainer> leftToRouterIPAddress;
-  leftToRouterIPAddress.push_back (ipAddresses.Assign (leftToRouter [0]));
-  ipAddresses.NewNetwork ();
-  leftToRouterIPAddress.push_back (ipAddresses.Assign (leftToRouter [1]));
-  ipAddresses.NewNetwork ();
-  leftToRouterIPAddress.push_back (ipAddresses.Assign (leftToRouter [2]));
-  ipAddresses.NewNetwork ();
-  leftToRouterIPAddress.push_back (ipAddresses.Assign (leftToRouter [3]));
-  ipAddresses.NewNetwork ();
-  leftToRouterIPAddress.push_back (ipAddresses.Assign (leftToRouter [4]));
-  ipAddresses.NewNetwork ();
-
-  std::vector <Ipv4InterfaceContainer> routerToRightIPAddress;
-  routerToRightIPAddress.push_back (ipAddresses.Assign (routerToRight [0]));
-  ipAddresses.NewNetwork ();
-  routerToRightIPAddress.push_back (ipAddresses.Assign (routerToRight [1]));
-  ipAddresses.NewNetwork ();
-  routerToRightIPAddress.push_back (ipAddresses.Assign (routerToRight [2]));
-  ipAddresses.NewNetwork ();
-  routerToRightIPAddress.push_back (ipAddresses.Assign (routerToRight [3]));
-  ipAddresses.NewNetwork ();
-  routerToRightIPAddress.push_back (ipAddresses.Assign (routerToRight [4]));
+  // Assign IP addresses: the bottleneck gets 10.0.0.0/30, and every leaf
+  // link a /30 out of 10.1.0.0/16 (left) or 10.2.0.0/16 (right)
+  Ipv4AddressHelper routerAddresses ("10.0.0.0", "255.255.255.252");
+  Ipv4InterfaceContainer r1r2IPAddress = routerAddresses.Assign (r1r2ND);
+  Ipv4AddressHelper leftAddresses ("10.1.0.0", "255.255.255.252");
+  Ipv4AddressHelper rightAddresses ("10.2.0.0", "255.255.255.252");
+
+  // Only the sink addresses are kept; devices and interfaces stay
+  // reachable through their nodes
+  std::vector<Ipv4Address> sinkAddresses;
+  sinkAddresses.reserve (nFlows);
+  Ipv4StaticRoutingHelper staticRouting;
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      NetDeviceContainer left = pointToPointLeaf.Install (leftNodes.Get (i), routers.Get (0));
+      Ipv4InterfaceContainer leftIf = leftAddresses.Assign (left);
+      leftAddresses.NewNetwork ();
+      staticRouting.GetStaticRouting (leftNodes.Get (i)->GetObject<Ipv4> ())
+        ->SetDefaultRoute (leftIf.GetAddress (1), 1);
+
+      NetDeviceContainer right = pointToPointLeaf.Install (routers.Get (1), rightNodes.Get (i));
+      Ipv4InterfaceContainer rightIf = rightAddresses.Assign (right);
+      rightAddresses.NewNetwork ();
+      staticRouting.GetStaticRouting (rightNodes.Get (i)->GetObject<Ipv4> ())
+        ->SetDefaultRoute (rightIf.GetAddress (0), 1);
+      sinkAddresses.push_back (rightIf.GetAddress (1));
+    }
+
+  // Each router reaches the far side's /16 through the bottleneck; leaf
+  // subnets on its own side are directly connected
+  Ptr<Ipv4> r1Ipv4 = routers.Get (0)->GetObject<Ipv4> ();
+  Ptr<Ipv4> r2Ipv4 = routers.Get (1)->GetObject<Ipv4> ();
+  staticRouting.GetStaticRouting (r1Ipv4)->AddNetworkRouteTo (Ipv4Address ("10.2.0.0"), Ipv4Mask ("255.255.0.0"),
+                                                              r1r2IPAddress.GetAddress (1),
+                                                              r1Ipv4->GetInterfaceForDevice (r1r2ND.Get (0)));
+  staticRouting.GetStaticRouting (r2Ipv4)->AddNetworkRouteTo (Ipv4Address ("10.1.0.0"), Ipv4Mask ("255.255.0.0"),
+                                                              r1r2IPAddress.GetAddress (0),
+                                                              r2Ipv4->GetInterfaceForDevice (r1r2ND.Get (1)));
+
+  // Install Packet Sink Application on all right side nodes
+  uint16_t port = 50000;
+  std::vector<Ptr<PacketSink> > sinks;
+  sinks.reserve (nFlows);
+  for (uint32_t i = 0; ownRight && i < nFlows; i++)
+    {
+      sinks.push_back (InstallPacketSink (rightNodes.Get (i), port));
+    }
+
+  // Install Bulk Send Application on all left side nodes.  Start each
+  // source application with an interval of 1 second from 11 s, shortened
+  // so that all of them have started half-way to the stop time.
+  std::vector<Ptr<BulkSendApplication> > sources;
+  double interval = nFlows > 1 ? std::max (0.0, std::min (1.0, (stopTime - 11.0) / (2.0 * (nFlows - 1)))) : 0;
+  for (uint32_t i = 0; bulk && ownLeft && i < nFlows; i++)
+    {
+      sources.push_back (InstallBulkSend (leftNodes.Get (i), sinkAddresses [i], port, Seconds (11.0 + i * interval)));
+    }
+
+  // Short flows from every left leaf to every right leaf; the single
+  // process owns both sides, as distributed runs have no workload
+  Ptr<FlowWorkload> workload;
+  if (flowRate > 0)
+    {
+      // Setting the stream again restarts it on the substream of this run
+      uv->SetStream (uv->GetStream ());
+      uv->SetAttribute ("Mean", DoubleValue (1 / flowRate));
+      workload = Create<FlowWorkload> (uv, flowSize, flowShape, 1000 * flowSize, port + 1, maxActiveFlows);
+      workload->SetStream (uv->GetStream () + 1);
+      for (uint32_t i = 0; i < nFlows; i++)
+        {
+          workload->AddSender (leftNodes.Get (i));
+          workload->AddReceiver (rightNodes.Get (i), sinkAddresses[i]);
+        }
+      workload->Start (Seconds (11.0), Seconds (stopTime));
+    }
+
+  topology->r1r2ND = r1r2ND;
+  topology->ownLeft = ownLeft;
+  topology->sinks = sinks;
+  topology->sources = sources;
+  topology->workload = workload;
+  topology->buildWall = runStats.GetWallSeconds ();
+}
+
+// Install the queue disc of config on the bottleneck of topology, run the
+// simulation and destroy it
+static RedResult
+RunOnTopology (const RedConfig &config, const RedTopology &topology)
+{
+  RunStats runStats;
+  bool ownLeft = topology.ownLeft;
+  const NetDeviceContainer &r1r2ND = topology.r1r2ND;
+  const std::vector<Ptr<PacketSink> > &sinks = topology.sinks;
 
   // Set values for Red Queue Disc attributes
   Config::SetDefault ("ns3::RedQueueDisc::ARED", BooleanValue (false));
   Config::SetDefault ("ns3::RedQueueDisc::Gentle", BooleanValue (false));
   Config::SetDefault ("ns3::RedQueueDisc::MeanPktSize", UintegerValue (512));
-  Config::SetDefault ("ns3::RedQueueDisc::MinTh", DoubleValue (20));
-  Config::SetDefault ("ns3::RedQueueDisc::MaxTh", DoubleValue (80));
-  Config::SetDefault ("ns3::RedQueueDisc::LInterm", DoubleValue (10));
-  Config::SetDefault (queue_disc_type + "::MaxSize", QueueSizeValue (QueueSize ("100p")));
+  Config::SetDefault ("ns3::RedQueueDisc::MinTh", DoubleValue (config.minTh));
+  Config::SetDefault ("ns3::RedQueueDisc::MaxTh", DoubleValue (config.maxTh));
+  Config::SetDefault ("ns3::RedQueueDisc::LInterm", DoubleValue (config.lInterm));
+  Config::SetDefault (config.queueDiscType + "::MaxSize", QueueSizeValue (QueueSize ("100p")));
 
   // Create traffic control helper to install queue disc on the net device container
   TrafficControlHelper tchBottleneck;
-  tchBottleneck.SetRootQueueDisc (queue_disc_type);
+  tchBottleneck.SetRootQueueDisc (config.queueDiscType);
   QueueDiscContainer qd;
-  tchBottleneck.Uninstall (routers.Get (0)->GetDevice (0));
-  qd.Add (tchBottleneck.Install (routers.Get (0)->GetDevice (0)).Get (0));
-  Simulator::ScheduleNow (&CheckQueueSize, qd.Get (0));
+  tchBottleneck.Uninstall (r1r2ND.Get (0));
+  qd.Add (tchBottleneck.Install (r1r2ND.Get (0)).Get (0));
+  Ptr<QueueOccupancyTracer> queueTracer;
+  if (ownLeft)
+    {
+      queueTracer = Create<QueueOccupancyTracer> (qd.Get (0));
+    }
+  if (ownLeft && traceQueue && queueInterval > 0)
+    {
+      queueTracer->SetDownsampling (Seconds (queueInterval), "queuered.plotme");
+    }
+  else if (ownLeft && traceQueue)
+    {
+      Ptr<TraceRecorder> queueRecorder = Create<TraceRecorder> (traceFormat == "binary" ? "queuered.bintrace" : "queuered.plotme");
+      queueRecorder->CloseOnDestroy ();
+      queueTracer->SetRecorder (queueRecorder);
+    }
+  if (ownLeft && traceQueue && !plotMethod.empty ())
+    {
+      Ptr<DecimatedPlot> queuePlot = Create<DecimatedPlot> ("queuered", config.queueDiscType.substr (5) + " bottleneck queue",
+                                                            "Time (s)", "Queue length (packets)",
+                                                            DecimatedPlot::ParseMethod (plotMethod));
+      queuePlot->AddSeries ("queue", Gnuplot2dDataset::STEPS);
+      queuePlot->WriteOnDestroy ();
+      queueTracer->SetPlot (queuePlot, 0);
+    }
 
-  // Install Packet Sink Application on all right side nodes
-  uint16_t port = 50000;
-  for (int i = 0; i < 5; i++)
+  // Per-flow latency, measured where the senders and the bottleneck are
+  LatencyProbe latency;
+  if (ownLeft)
+    {
+      latency.rtt.resize (nFlows);
+      latency.sojourn.resize (nFlows);
+      qd.Get (0)->TraceConnectWithoutContext ("Dequeue", MakeBoundCallback (&ProbeSojourn, &latency));
+      for (uint32_t i = 0; i < topology.sources.size (); i++)
+        {
+          TimeValue start;
+          topology.sources[i]->GetAttribute ("StartTime", start);
+          Simulator::Schedule (start.Get () - Simulator::Now () + TimeStep (1), &ConnectRtt,
+                               topology.sources[i], &latency.rtt[i]);
+        }
+    }
+
+  if (topology.workload && traceQueue)
     {
-      InstallPacketSink (rightNodes.Get (i), port);
+      Ptr<TraceRecorder> fctRecorder = Create<TraceRecorder> ("red-fct.plotme", ' ', false);
+      fctRecorder->CloseOnDestroy ();
+      topology.workload->SetRecorder (fctRecorder);
     }
 
-  // Install Bulk Send Application on all left side nodes
-  for (int i = 0; i < 5; i++)
+  // Each process publishes its own segment; in a distributed run every
+  // rank shows the part of the dumbbell it simulates
+  if (!live.empty ())
     {
-      InstallBulkSend (leftNodes.Get (i), routerToRightIPAddress [i].GetAddress (1), port);
+      std::ostringstream label;
+      label << config.queueDiscType.substr (5) << " run " << config.run;
+      Ptr<LiveMetricsPublisher> publisher = Create<LiveMetricsPublisher> (live, label.str (), Seconds (liveInterval));
+      if (queueTracer)
+        {
+          publisher->SetQueue (MakeCallback (&QueueDisc::GetNPackets, qd.Get (0)));
+        }
+      for (uint32_t i = 0; i < sinks.size (); i++)
+        {
+          publisher->AddFlow (MakeCallback (&PacketSink::GetTotalRx, sinks[i]));
+        }
     }
 
-  // Initialize routing table for each node
-  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  double buildWall = topology.buildWall + runStats.GetWallSeconds ();
+  runStats.Reset ();
 
   // Run the simulation
   Simulator::Stop (Seconds (stopTime));
   Simulator::Run ();
 
+  if (printStats)
+    {
+      double runWall = runStats.GetWallSeconds ();
+      uint64_t events = Simulator::GetEventCount ();
+      std::cout << "flows " << nFlows
+                << " build " << buildWall << " s"
+                << " run " << runWall << " s"
+                << " events " << events
+                << " events/s " << events / runWall
+                << " peakActiveFlows " << (topology.workload ? topology.workload->GetPeakActive () : 0)
+                << " peakSockets " << (topology.workload ? topology.workload->GetPeakSockets () : 0)
+                << " peakRss " << RunStats::GetPeakRssKb () << " kB" << std::endl;
+    }
+
+  // Received bytes, mean queue length and drops; each rank only knows
+  // the values of the nodes it simulated
+  double totals[3] = { 0, 0, 0 };
+  for (uint32_t i = 0; i < sinks.size (); i++)
+    {
+      totals[0] += sinks[i]->GetTotalRx ();
+    }
+  if (queueTracer)
+    {
+      queueTracer->Finish ();
+      totals[1] = queueTracer->GetMean ();
+      totals[2] = qd.Get (0)->GetStats ().nTotalDroppedPackets;
+    }
+#ifdef NS3_MPI
+  if (systemCount > 1)
+    {
+      MPI_Allreduce (MPI_IN_PLACE, totals, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+#endif
+
+  // Goodput of all flows from the start of the first source
+  RedResult result;
+  result.goodput = stopTime > 11.0 ? totals[0] * 8.0 / (stopTime - 11.0) : 0;
+  result.meanQueue = totals[1];
+  result.drops = static_cast<uint64_t> (totals[2]);
+  result.flowsStarted = topology.workload ? topology.workload->GetStarted () : 0;
+  result.flowsRejected = topology.workload ? topology.workload->GetRejected () : 0;
+  result.flowsFailed = topology.workload ? topology.workload->GetFailed () : 0;
+  if (topology.workload)
+    {
+      result.fct = topology.workload->GetCompletionTimes ();
+    }
+  for (uint32_t i = 0; i < latency.rtt.size (); i++)
+    {
+      result.rtt.Merge (latency.rtt[i]);
+      result.sojourn.Merge (latency.sojourn[i]);
+    }
+
+  // One line per flow: flow, then p50, p99 and p99.9 of its RTT and of
+  // its sojourn time at the bottleneck (ms)
+  if (ownLeft && traceQueue)
+    {
+      std::ofstream latencyFile ("red-latency.plotme", std::ios::out | std::ios::trunc);
+      for (uint32_t i = 0; i < latency.rtt.size (); i++)
+        {
+          latencyFile << i << " " << Quantiles (latency.rtt[i]) << " " << Quantiles (latency.sojourn[i]) << "\n";
+        }
+      latencyFile.close ();
+    }
+
   // Release resources at the end of simulation
   Simulator::Destroy ();
+  return result;
+}
+
+// Run the simulation for one configuration
+static RedResult
+RunSimulation (const RedConfig &config)
+{
+  RngSeedManager::SetRun (config.run);
+  RedTopology topology;
+  BuildTopology (&topology);
+  return RunOnTopology (config, topology);
+}
+
+// Sweep points of the current batch, shared with the worker processes
+std::vector<RedConfig> batch;
+
+// Short flows started, completed, rejected and failed, and p50, p99 and p99.9 of
+// their completion times; empty without a workload
+static std::string
+FlowSummary (const RedResult &result)
+{
+  std::ostringstream oss;
+  if (flowRate > 0)
+    {
+      oss << " flows " << result.flowsStarted << " completed " << result.fct.GetCount ()
+          << " rejected " << result.flowsRejected << " failed " << result.flowsFailed << " fct " << Quantiles (result.fct) << " ms";
+    }
+  return oss.str ();
+}
+
+// Result of a run as the text a worker process hands back
+static std::string
+SerializeResult (const RedResult &result)
+{
+  std::ostringstream oss;
+  oss.precision (17);
+  oss << result.goodput << " " << result.meanQueue << " " << result.drops
+      << " " << result.rtt.Serialize () << " " << result.sojourn.Serialize ()
+      << " " << result.flowsStarted << " " << result.flowsRejected << " " << result.flowsFailed
+      << " " << result.fct.Serialize ();
+  return oss.str ();
+}
+
+static RedResult
+ParseResult (const std::string &text)
+{
+  RedResult result = RedResult ();
+  std::istringstream iss (text);
+  iss >> result.goodput >> result.meanQueue >> result.drops;
+  result.rtt.Parse (iss);
+  result.sojourn.Parse (iss);
+  iss >> result.flowsStarted >> result.flowsRejected >> result.flowsFailed;
+  result.fct.Parse (iss);
+  return result;
+}
+
+// Job body for the worker pool: job i simulates batch[i]
+static std::string
+RunBatchPoint (uint32_t index)
+{
+  return SerializeResult (RunSimulation (batch[index]));
+}
+
+// Simulate every point of the batch, in process or on the worker pool
+static std::vector<RedResult>
+RunBatch (uint32_t jobs)
+{
+  std::vector<RedResult> results;
+  if (jobs == 1)
+    {
+      for (uint32_t i = 0; i < batch.size (); i++)
+        {
+          results.push_back (RunSimulation (batch[i]));
+        }
+      return results;
+    }
+
+  ParallelRunner runner (jobs);
+  std::vector<std::string> texts = runner.Run (batch.size (), MakeCallback (&RunBatchPoint));
+  for (uint32_t i = 0; i < texts.size (); i++)
+    {
+      results.push_back (ParseResult (texts[i]));
+    }
+  return results;
+}
+
+// Dumbbell shared by the what-if branches
+RedTopology branchTopology;
+
+// Job body of a what-if branch, in a process forked after the build:
+// branch i runs batch[i] on the shared dumbbell
+static std::string
+RunBranch (uint32_t index)
+{
+  return SerializeResult (RunOnTopology (batch[index], branchTopology));
+}
+
+// Build the dumbbell once and run every variant of config on it, each in
+// a process forked from the built state.  Queue disc settings are fixed
+// once the simulation initializes at 0 s, and no packet is sent before
+// the sources start, so the branches share the build, which grows with
+// nFlows, rather than simulated time.
+static void
+RunBranches (const RedConfig &config, const std::string &branches, uint32_t jobs)
+{
+  std::vector<std::vector<std::pair<std::string, std::string> > > variants = BranchRunner::ParseVariants (branches);
+  std::vector<std::string> labels;
+  batch.clear ();
+  for (uint32_t v = 0; v < variants.size (); v++)
+    {
+      RedConfig variant = config;
+      std::ostringstream label;
+      for (uint32_t i = 0; i < variants[v].size (); i++)
+        {
+          const std::string &name = variants[v][i].first;
+          const std::string &value = variants[v][i].second;
+          label << (i ? "," : "") << name << "=" << value;
+          if (name == "queue_disc_type")
+            {
+              variant.queueDiscType = "ns3::" + value;
+              TypeId tid;
+              NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (variant.queueDiscType, &tid), "TypeId " << variant.queueDiscType << " not found");
+              continue;
+            }
+          double number;
+          std::istringstream iss (value);
+          NS_ABORT_MSG_UNLESS (iss >> number && iss.eof (), "Bad value " << value << " of " << name);
+          if (name == "minTh")
+            {
+              variant.minTh = number;
+            }
+          else if (name == "maxTh")
+            {
+              variant.maxTh = number;
+            }
+          else if (name == "lInterm")
+            {
+              variant.lInterm = number;
+            }
+          else
+            {
+              NS_ABORT_MSG ("Unknown change " << name << " (queue_disc_type, minTh, maxTh, lInterm)");
+            }
+        }
+      batch.push_back (variant);
+      labels.push_back (variants[v].empty () ? "unchanged" : label.str ());
+    }
+
+  RngSeedManager::SetRun (config.run);
+  BuildTopology (&branchTopology);
+  BranchRunner runner (jobs);
+  std::vector<std::string> texts = runner.Run (Seconds (0), batch.size (), MakeCallback (&RunBranch));
+  for (uint32_t i = 0; i < texts.size (); i++)
+    {
+      RedResult result = ParseResult (texts[i]);
+      std::cout << labels[i] << ": goodput " << result.goodput / 1e6 << " Mbps"
+                << " meanQueue " << result.meanQueue << " packets"
+                << " drops " << result.drops
+                << " rtt " << Quantiles (result.rtt) << " ms"
+                << " sojourn " << Quantiles (result.sojourn) << " ms"
+                << FlowSummary (result) << std::endl;
+    }
+  branchTopology = RedTopology ();
+  Simulator::Destroy ();
+}
+
+// Run replications of RED and FIFO until the 95% confidence intervals of
+// goodput, mean queue length and drops are within precision of their
+// means, or maxReplications is reached.  Replication r of both queue
+// discs uses RngRun firstRun + r, so replications never share random
+// number substreams and RED and FIFO see the same traffic.
+static void
+RunEnsemble (RedConfig config, uint32_t maxReplications, double precision, uint32_t jobs)
+{
+  const char *discs[] = { "ns3::RedQueueDisc", "ns3::FifoQueueDisc" };
+  const uint32_t nDiscs = 2;
+  uint64_t firstRun = RngSeedManager::GetRun ();
+  uint32_t perRound = std::max<uint32_t> (1, ParallelRunner (jobs).GetMaxWorkers () / nDiscs);
+  // statistics of goodput, mean queue length and drops per queue disc
+  std::vector<std::vector<ReplicationStats> > stats (nDiscs, std::vector<ReplicationStats> (3));
+  // RTT and sojourn times of all replications per queue disc
+  std::vector<QuantileSketch> rtt (nDiscs);
+  std::vector<QuantileSketch> sojourn (nDiscs);
+  std::vector<QuantileSketch> fct (nDiscs);
+
+  uint32_t done = 0;
+  while (done < maxReplications)
+    {
+      batch.clear ();
+      uint32_t round = std::min (perRound, maxReplications - done);
+      for (uint32_t r = done; r < done + round; r++)
+        {
+          for (uint32_t d = 0; d < nDiscs; d++)
+            {
+              config.queueDiscType = discs[d];
+              config.run = firstRun + r;
+              batch.push_back (config);
+            }
+        }
+      std::vector<RedResult> results = RunBatch (jobs);
+      for (uint32_t i = 0; i < results.size (); i++)
+        {
+          stats[i % nDiscs][0].Add (results[i].goodput / 1e6);
+          stats[i % nDiscs][1].Add (results[i].meanQueue);
+          stats[i % nDiscs][2].Add (results[i].drops);
+          rtt[i % nDiscs].Merge (results[i].rtt);
+          sojourn[i % nDiscs].Merge (results[i].sojourn);
+          fct[i % nDiscs].Merge (results[i].fct);
+        }
+      done += round;
+
+      bool precise = done >= 3;
+      for (uint32_t d = 0; d < nDiscs; d++)
+        {
+          for (uint32_t m = 0; m < stats[d].size (); m++)
+            {
+              precise = precise && stats[d][m].IsPrecise (precision);
+            }
+        }
+      if (precise)
+        {
+          break;
+        }
+    }
+
+  // One line per queue disc: replications, then mean and CI half-width of
+  // goodput (Mbps), mean queue length (packets) and drops (packets), and
+  // p50, p99 and p99.9 of RTT, sojourn time and short flow completion
+  // time over all replications (ms)
+  std::ofstream ensembleFile ("ensemble.plotme", std::ios::out | std::ios::trunc);
+  for (uint32_t d = 0; d < nDiscs; d++)
+    {
+      std::ostringstream line;
+      line << discs[d] << " " << done;
+      for (uint32_t m = 0; m < stats[d].size (); m++)
+        {
+          line << " " << stats[d][m].GetMean () << " " << stats[d][m].GetHalfWidth ();
+        }
+      line << " " << Quantiles (rtt[d]) << " " << Quantiles (sojourn[d]) << " " << Quantiles (fct[d]);
+      ensembleFile << line.str () << "\n";
+      std::cout << line.str () << std::endl;
+    }
+  ensembleFile.close ();
+}
+
+// Main function
+int main (int argc, char *argv[])
+{
+  uint32_t stream = 1;
+  std::string transport_prot = "TcpNewReno";
+  std::string queue_disc_type = "RedQueueDisc";
+  double minTh = 20;
+  double maxTh = 80;
+  double lInterm = 10;
+  uint32_t jobs = 1;
+  std::string sweepMode;
+  std::string minThRange;
+  std::string maxThRange;
+  std::string lIntermRange;
+  std::string sweepMetric = "queue";
+  uint32_t sweepBudget = 200;
+  double sweepTolerance = 0.02;
+  uint32_t ensemble = 0;
+  double ensemblePrecision = 0.05;
+  bool distributed = false;
+  std::string branches;
+  std::string scheduler = "map";
+  std::string profile;
+
+  CommandLine cmd;
+  cmd.AddValue ("stream", "Seed value for random variable", stream);
+  cmd.AddValue ("queue_disc_type", "Queue disc type for gateway (e.g. ns3::FifoQueueDisc or ns3::RedQueueDisc)", queue_disc_type);
+  cmd.AddValue ("stopTime", "Stop time for applications / simulation time will be stopTime", stopTime);
+  cmd.AddValue ("nFlows", "Number of sender/receiver pairs sharing the bottleneck", nFlows);
+  cmd.AddValue ("printStats", "Print build time, run time, events per second and peak RSS of every run", printStats);
+  cmd.AddValue ("queueInterval", "Write min, max and mean queue length per interval of this many seconds to queuered.plotme instead of every change (0 = every change)", queueInterval);
+  cmd.AddValue ("traceFormat", "Format of the per-change queue trace: text (queuered.plotme) or binary (queuered.bintrace, read with bintrace)", traceFormat);
+  cmd.AddValue ("plot", "Also write queuered.plt, a gnuplot script of the queue length decimated with minmax or lttb", plotMethod);
+  cmd.AddValue ("minTh", "RED minimum threshold in packets", minTh);
+  cmd.AddValue ("maxTh", "RED maximum threshold in packets", maxTh);
+  cmd.AddValue ("lInterm", "RED inverse of the maximum drop probability", lInterm);
+  cmd.AddValue ("bulk", "Run a long-lived bulk flow on every sender/receiver pair", bulk);
+  cmd.AddValue ("flowRate", "Short flows arriving per second between random leaves, with completion times written to red-fct.plotme (0 = none)", flowRate);
+  cmd.AddValue ("flowSize", "Mean short flow size in bytes (Pareto, bounded at 1000 times the mean)", flowSize);
+  cmd.AddValue ("flowShape", "Pareto shape of the short flow sizes (> 1)", flowShape);
+  cmd.AddValue ("maxActiveFlows", "Short flows in progress beyond which arrivals are rejected", maxActiveFlows);
+  cmd.AddValue ("jobs", "Number of sweep points, replications or branches simulated in parallel worker processes (0 = one per core)", jobs);
+  cmd.AddValue ("sweep", "Set to adaptive to sweep the RED parameters into red-sweep.plotme", sweepMode);
+  cmd.AddValue ("minThRange", "Adaptive sweep: MinTh range, lo:hi[:step] (default: fixed at minTh)", minThRange);
+  cmd.AddValue ("maxThRange", "Adaptive sweep: MaxTh range, lo:hi[:step] (default: fixed at maxTh)", maxThRange);
+  cmd.AddValue ("lIntermRange", "Adaptive sweep: LInterm range, lo:hi[:step] (default: fixed at lInterm)", lIntermRange);
+  cmd.AddValue ("sweepMetric", "Adaptive sweep: metric to refine on, queue (mean length) or goodput", sweepMetric);
+  cmd.AddValue ("sweepBudget", "Adaptive sweep: maximum number of simulated points", sweepBudget);
+  cmd.AddValue ("sweepTolerance", "Adaptive sweep: smallest metric change, relative to the overall range, that is refined", sweepTolerance);
+  cmd.AddValue ("ensemble", "Run up to this many replications of both RED and FIFO and write means with 95% confidence intervals to ensemble.plotme", ensemble);
+  cmd.AddValue ("ensemblePrecision", "Stop adding replications once every confidence half-width is within this fraction of its mean", ensemblePrecision);
+  cmd.AddValue ("branches", "What-if variants sharing one build of the dumbbell, e.g. \"queue_disc_type=FifoQueueDisc;minTh=10,maxTh=40\": semicolon-separated, each a comma-separated list of queue_disc_type, minTh, maxTh or lInterm changes; an empty variant changes nothing", branches);
+  cmd.AddValue ("distributed", "Split the dumbbell at the R1-R2 link over two MPI ranks (run with mpirun -np 2)", distributed);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar, priority or timerwheel", scheduler);
+  cmd.AddValue ("profile", "Profile wall time per event type into <profile>.txt and <profile>.folded", profile);
+  cmd.AddValue ("live", "Publish progress of every run to the shared-memory segment <live>.<pid>.<run>, shown by live-metrics-reader", live);
+  cmd.AddValue ("liveInterval", "Simulated seconds between live-metrics updates", liveInterval);
+  cmd.Parse (argc,argv);
+  NS_ABORT_MSG_UNLESS (traceFormat == "text" || traceFormat == "binary", "Unknown trace format " << traceFormat);
+  // The per-interval summary has four columns and is always text
+  NS_ABORT_MSG_IF (queueInterval > 0 && traceFormat == "binary",
+                   "--traceFormat=binary applies to the per-change queue trace; it cannot be combined with --queueInterval");
+  if (!plotMethod.empty ())
+    {
+      DecimatedPlot::ParseMethod (plotMethod);
+    }
+  SelectScheduler (scheduler);
+  if (!profile.empty ())
+    {
+      ProfilingScheduler::Enable (profile);
+    }
+
+  uv->SetStream (stream);
+  transport_prot = std::string ("ns3::") + transport_prot;
+  queue_disc_type = std::string ("ns3::") + queue_disc_type;
+
+  // One /30 per leaf link out of a /16 per side
+  NS_ABORT_MSG_UNLESS (nFlows >= 1 && nFlows <= 16384, "nFlows must be between 1 and 16384");
+
+  TypeId qdTid;
+  NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (queue_disc_type, &qdTid), "TypeId " << queue_disc_type << " not found");
+
+  RedConfig config;
+  config.queueDiscType = queue_disc_type;
+  config.minTh = minTh;
+  config.maxTh = maxTh;
+  config.lInterm = lInterm;
+  config.run = RngSeedManager::GetRun ();
+
+  if (distributed)
+    {
+      NS_ABORT_MSG_IF (ensemble > 0 || !sweepMode.empty (), "A distributed run simulates a single configuration");
+      NS_ABORT_MSG_IF (flowRate > 0, "Short flows need both sides of the dumbbell in one process");
+#ifdef NS3_MPI
+      // Conservative synchronization; the lookahead is the 10 ms delay
+      // of the R1-R2 link, the only channel between the ranks
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+      MpiInterface::Enable (&argc, &argv);
+      systemId = MpiInterface::GetSystemId ();
+      systemCount = MpiInterface::GetSize ();
+      NS_ABORT_MSG_UNLESS (systemCount == 2, "A distributed run needs exactly 2 MPI ranks, not " << systemCount);
+#else
+      NS_ABORT_MSG ("Distributed runs need ns-3 built with --enable-mpi");
+#endif
+    }
+
+  if (!branches.empty ())
+    {
+      NS_ABORT_MSG_IF (distributed || ensemble > 0 || !sweepMode.empty (), "Branches cannot be combined with distributed runs, ensembles or sweeps");
+      traceQueue = false;
+      RunBranches (config, branches, jobs);
+      return 0;
+    }
+
+  if (ensemble > 0)
+    {
+      traceQueue = false;
+      RunEnsemble (config, ensemble, ensemblePrecision, jobs);
+      return 0;
+    }
+
+  if (sweepMode.empty ())
+    {
+      RedResult result = RunSimulation (config);
+      if (systemId == 0)
+        {
+          std::cout << "goodput " << result.goodput / 1e6 << " Mbps"
+                    << " meanQueue " << result.meanQueue << " packets"
+                    << " drops " << result.drops
+                    << " rtt " << Quantiles (result.rtt) << " ms"
+                    << " sojourn " << Quantiles (result.sojourn) << " ms"
+                    << FlowSummary (result) << std::endl;
+        }
+#ifdef NS3_MPI
+      if (distributed)
+        {
+          MpiInterface::Disable ();
+        }
+#endif
+      return 0;
+    }
+
+  NS_ABORT_MSG_UNLESS (sweepMode == "adaptive", "Unknown sweep mode " << sweepMode);
+  NS_ABORT_MSG_UNLESS (sweepMetric == "queue" || sweepMetric == "goodput", "Unknown sweep metric " << sweepMetric);
+  traceQueue = false;
+  AdaptiveSweep sweep (sweepBudget, sweepTolerance);
+  NS_ABORT_MSG_UNLESS (sweep.AddDimension ("minTh", minThRange, minTh), "Bad minThRange " << minThRange);
+  NS_ABORT_MSG_UNLESS (sweep.AddDimension ("maxTh", maxThRange, maxTh), "Bad maxThRange " << maxThRange);
+  NS_ABORT_MSG_UNLESS (sweep.AddDimension ("lInterm", lIntermRange, lInterm), "Bad lIntermRange " << lIntermRange);
+
+  std::vector<AdaptiveSweep::Point> points;
+  // Result of every point with the configuration actually simulated
+  std::map<AdaptiveSweep::Point, std::pair<RedConfig, RedResult> > results;
+  while (!(points = sweep.NextBatch ()).empty ())
+    {
+      batch.clear ();
+      for (uint32_t i = 0; i < points.size (); i++)
+        {
+          std::vector<double> values = sweep.GetValues (points[i]);
+          config.minTh = values[0];
+          // RED needs MinTh < MaxTh; corners outside that are moved onto the edge
+          config.maxTh = std::max (values[1], values[0] + 1);
+          config.lInterm = values[2];
+          batch.push_back (config);
+        }
+      std::vector<RedResult> batchResults = RunBatch (jobs);
+      for (uint32_t i = 0; i < points.size (); i++)
+        {
+          results[points[i]] = std::make_pair (batch[i], batchResults[i]);
+          sweep.SetResult (points[i], sweepMetric == "queue" ? batchResults[i].meanQueue : batchResults[i].goodput);
+        }
+    }
+
+  // MinTh, MaxTh, LInterm as simulated, goodput (Mbps) and mean queue
+  // length (packets)
+  std::ofstream sweepFile ("red-sweep.plotme", std::ios::out | std::ios::trunc);
+  for (std::map<AdaptiveSweep::Point, std::pair<RedConfig, RedResult> >::const_iterator it = results.begin (); it != results.end (); ++it)
+    {
+      const RedConfig &simulated = it->second.first;
+      sweepFile << simulated.minTh << " " << simulated.maxTh << " " << simulated.lInterm << " "
+                << (it->second.second.goodput / 1e6) << " " << it->second.second.meanQueue << "\n";
+    }
+  sweepFile.close ();
   return 0;
 }
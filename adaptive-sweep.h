@@ -0,0 +1,372 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef ADAPTIVE_SWEEP_H
+#define ADAPTIVE_SWEEP_H
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * Adaptive sampling of a metric over a box of parameters.
+ *
+ * The box is kept as a set of cells whose corners have all been
+ * evaluated.  Each round splits the cells in which the metric changes
+ * the most, along the parameter that explains most of the change, and
+ * asks for the new corners.  Cells on a plateau are never split, so the
+ * samples concentrate near knees instead of filling a Cartesian grid.
+ *
+ * The sweep is driven by the caller, which decides how points are
+ * evaluated (in process or on a ParallelRunner):
+ *
+ * \code
+ *   while (!(batch = sweep.NextBatch ()).empty ())
+ *     for (i ...) sweep.SetResult (batch[i], Evaluate (sweep.GetValues (batch[i])));
+ * \endcode
+ */
+class AdaptiveSweep
+{
+public:
+  /// Lattice coordinates of a sample point, one per dimension
+  typedef std::vector<uint32_t> Point;
+
+  /**
+   * \param budget maximum number of evaluated points
+   * \param tolerance cells whose metric range is below this fraction of
+   *        the overall metric range are not split
+   * \param cellsPerRound number of cells split per round
+   */
+  AdaptiveSweep (uint32_t budget = 200, double tolerance = 0.02, uint32_t cellsPerRound = 8)
+    : m_budget (budget),
+      m_tolerance (tolerance),
+      m_cellsPerRound (cellsPerRound),
+      m_started (false)
+  {
+  }
+
+  /**
+   * Add a parameter ranging over [lo, hi].
+   *
+   * \param step spacing of the values the parameter may take; 0 for a
+   *        continuous parameter, which is resolved to 1/1024 of the range
+   */
+  void AddDimension (std::string name, double lo, double hi, double step = 0)
+  {
+    Dimension dim;
+    dim.name = name;
+    dim.lo = lo;
+    dim.hi = hi;
+    dim.step = step;
+    if (step > 0)
+      {
+        dim.units = static_cast<uint32_t> (std::floor ((hi - lo) / step + 0.5));
+      }
+    else
+      {
+        dim.units = hi > lo ? 1024 : 0;
+      }
+    m_dims.push_back (dim);
+  }
+
+  /**
+   * Add a parameter given as a "lo:hi[:step]" range.  An empty range
+   * fixes the parameter at def.
+   *
+   * \return false if the range cannot be parsed
+   */
+  bool AddDimension (std::string name, std::string range, double def)
+  {
+    double lo = def;
+    double hi = def;
+    double step = 0;
+    if (!range.empty ())
+      {
+        char sep = 0;
+        std::istringstream iss (range);
+        if (!(iss >> lo >> sep >> hi) || sep != ':' || hi < lo)
+          {
+            return false;
+          }
+        if (iss >> sep && (sep != ':' || !(iss >> step) || step <= 0))
+          {
+            return false;
+          }
+      }
+    AddDimension (name, lo, hi, step);
+    return true;
+  }
+
+  uint32_t GetDimensions (void) const
+  {
+    return m_dims.size ();
+  }
+
+  std::string GetName (uint32_t dim) const
+  {
+    return m_dims[dim].name;
+  }
+
+  /// Parameter values of a point
+  std::vector<double> GetValues (const Point &point) const
+  {
+    std::vector<double> values (m_dims.size ());
+    for (size_t i = 0; i < m_dims.size (); i++)
+      {
+        const Dimension &dim = m_dims[i];
+        if (dim.units == 0)
+          {
+            values[i] = dim.lo;
+          }
+        else if (dim.step > 0)
+          {
+            values[i] = dim.lo + point[i] * dim.step;
+          }
+        else
+          {
+            values[i] = dim.lo + (dim.hi - dim.lo) * point[i] / dim.units;
+          }
+      }
+    return values;
+  }
+
+  /**
+   * Next points to evaluate.  An empty batch means the sweep is done,
+   * either because the budget is spent or no cell is worth splitting.
+   */
+  std::vector<Point> NextBatch (void)
+  {
+    std::set<Point> pending;
+    if (!m_started)
+      {
+        m_started = true;
+        Cell root;
+        root.lo.assign (m_dims.size (), 0);
+        for (size_t i = 0; i < m_dims.size (); i++)
+          {
+            root.extent.push_back (m_dims[i].units);
+          }
+        m_cells.push_back (root);
+        // Start from a 3 x 3 x ... grid so that features between the
+        // corners of the box are not missed
+        for (uint32_t axis = 0; axis < m_dims.size (); axis++)
+          {
+            size_t n = m_cells.size ();
+            for (size_t c = 0; c < n; c++)
+              {
+                if (m_cells[c].extent[axis] >= 2)
+                  {
+                    m_cells.push_back (Split (m_cells[c], axis));
+                  }
+              }
+          }
+        for (size_t c = 0; c < m_cells.size (); c++)
+          {
+            AddCorners (m_cells[c], pending);
+          }
+        return std::vector<Point> (pending.begin (), pending.end ());
+      }
+
+    // Score every cell and split the best ones
+    std::vector<std::pair<double, size_t> > scores;
+    for (size_t c = 0; c < m_cells.size (); c++)
+      {
+        double score = Score (m_cells[c]);
+        if (score > 0)
+          {
+            scores.push_back (std::make_pair (score, c));
+          }
+      }
+    std::sort (scores.rbegin (), scores.rend ());
+
+    std::vector<Cell> added;
+    for (size_t k = 0; k < scores.size () && k < m_cellsPerRound; k++)
+      {
+        if (m_results.size () + pending.size () >= m_budget)
+          {
+            break;
+          }
+        Cell &cell = m_cells[scores[k].second];
+        Cell upper = Split (cell, SplitAxis (cell));
+        AddCorners (cell, pending);
+        AddCorners (upper, pending);
+        added.push_back (upper);
+      }
+    m_cells.insert (m_cells.end (), added.begin (), added.end ());
+    return std::vector<Point> (pending.begin (), pending.end ());
+  }
+
+  void SetResult (const Point &point, double value)
+  {
+    m_results[point] = value;
+  }
+
+  /// Every evaluated point and its metric
+  const std::map<Point, double> &GetResults (void) const
+  {
+    return m_results;
+  }
+
+private:
+  struct Dimension
+  {
+    std::string name;
+    double lo;
+    double hi;
+    double step;
+    uint32_t units;     //!< number of lattice steps from lo to hi
+  };
+
+  struct Cell
+  {
+    Point lo;
+    std::vector<uint32_t> extent;
+  };
+
+  /// Halve a cell along an axis; the cell keeps the lower half
+  static Cell Split (Cell &cell, uint32_t axis)
+  {
+    Cell upper = cell;
+    uint32_t half = cell.extent[axis] / 2;
+    upper.lo[axis] += half;
+    upper.extent[axis] -= half;
+    cell.extent[axis] = half;
+    return upper;
+  }
+
+  Point Corner (const Cell &cell, uint32_t mask) const
+  {
+    Point p = cell.lo;
+    for (size_t i = 0; i < p.size (); i++)
+      {
+        if (mask & (1u << i))
+          {
+            p[i] += cell.extent[i];
+          }
+      }
+    return p;
+  }
+
+  void AddCorners (const Cell &cell, std::set<Point> &pending) const
+  {
+    for (uint32_t mask = 0; mask < (1u << m_dims.size ()); mask++)
+      {
+        Point p = Corner (cell, mask);
+        if (m_results.find (p) == m_results.end ())
+          {
+            pending.insert (p);
+          }
+      }
+  }
+
+  double Value (const Point &p) const
+  {
+    std::map<Point, double>::const_iterator it = m_results.find (p);
+    return it == m_results.end () ? 0 : it->second;
+  }
+
+  /// Metric range over the cell corners relative to the overall range,
+  /// or 0 when the cell cannot or need not be split
+  double Score (const Cell &cell) const
+  {
+    bool splittable = false;
+    for (size_t i = 0; i < cell.extent.size (); i++)
+      {
+        splittable = splittable || cell.extent[i] >= 2;
+      }
+    if (!splittable || m_results.empty ())
+      {
+        return 0;
+      }
+
+    double gmin = m_results.begin ()->second;
+    double gmax = gmin;
+    for (std::map<Point, double>::const_iterator it = m_results.begin (); it != m_results.end (); ++it)
+      {
+        gmin = std::min (gmin, it->second);
+        gmax = std::max (gmax, it->second);
+      }
+    if (gmax <= gmin)
+      {
+        return 0;
+      }
+
+    double cmin = Value (cell.lo);
+    double cmax = cmin;
+    for (uint32_t mask = 1; mask < (1u << m_dims.size ()); mask++)
+      {
+        double v = Value (Corner (cell, mask));
+        cmin = std::min (cmin, v);
+        cmax = std::max (cmax, v);
+      }
+    double range = (cmax - cmin) / (gmax - gmin);
+    return range < m_tolerance ? 0 : range;
+  }
+
+  /// Splittable axis with the largest mean change of the metric along it
+  uint32_t SplitAxis (const Cell &cell) const
+  {
+    uint32_t best = 0;
+    double bestChange = -1;
+    for (uint32_t axis = 0; axis < m_dims.size (); axis++)
+      {
+        if (cell.extent[axis] < 2)
+          {
+            continue;
+          }
+        double change = 0;
+        for (uint32_t mask = 0; mask < (1u << m_dims.size ()); mask++)
+          {
+            if (!(mask & (1u << axis)))
+              {
+                change += std::fabs (Value (Corner (cell, mask | (1u << axis))) - Value (Corner (cell, mask)));
+              }
+          }
+        // Prefer wide axes when the corners do not tell them apart
+        change += 1e-9 * cell.extent[axis] / m_dims[axis].units;
+        if (change > bestChange)
+          {
+            bestChange = change;
+            best = axis;
+          }
+      }
+    return best;
+  }
+
+  uint32_t m_budget;
+  double m_tolerance;
+  uint32_t m_cellsPerRound;
+  bool m_started;
+  std::vector<Dimension> m_dims;
+  std::vector<Cell> m_cells;
+  std::map<Point, double> m_results;
+};
+
+} // namespace ns3
+
+#endif /* ADAPTIVE_SWEEP_H */
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Number of heap allocations made through operator new by the whole
+ * process, ns-3 libraries included.
+ *
+ * Including this header replaces the global operator new and delete, so
+ * it must be included by exactly one translation unit of a program.  The
+ * count costs one relaxed atomic increment per allocation.
+ */
+class AllocationCounter
+{
+public:
+  static uint64_t Get (void)
+  {
+    return Count ().load (std::memory_order_relaxed);
+  }
+
+  static std::atomic<uint64_t> &Count (void)
+  {
+    static std::atomic<uint64_t> count (0);
+    return count;
+  }
+};
+
+} // namespace ns3
+
+void *
+operator new (std::size_t size)
+{
+  ns3::AllocationCounter::Count ().fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size ? size : 1);
+  if (!p)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void *
+operator new (std::size_t size, const std::nothrow_t &) noexcept
+{
+  ns3::AllocationCounter::Count ().fetch_add (1, std::memory_order_relaxed);
+  return std::malloc (size ? size : 1);
+}
+
+void *
+operator new[] (std::size_t size, const std::nothrow_t &tag) noexcept
+{
+  return operator new (size, tag);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+#endif /* ALLOCATION_COUNTER_H */
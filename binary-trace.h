@@ -0,0 +1,533 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+
+/**
+ * Columnar binary trace files (.bintrace).
+ *
+ * A trace is a sequence of rows of a fixed number of numeric columns;
+ * the first column is the key (usually time in seconds) used for range
+ * queries.  Rows are grouped into blocks of up to BLOCK_ROWS rows, and
+ * a block stores each column separately: a decimal exponent d followed
+ * by, for every row, the difference between round(value * 10^d) and
+ * that of the previous row, zigzag-encoded as a varint.  d is the
+ * smallest exponent that keeps every value of the column in the block
+ * to a relative error of 1e-12, up to 9, so integer columns such as
+ * queue lengths take one byte per changed row, timestamps keep
+ * nanosecond resolution, and other values are rounded to 1e-9 at worst.
+ * Values must be finite and below 1e9 in magnitude to keep that
+ * resolution; larger ones get fewer decimals.
+ *
+ * Layout, all integers little-endian:
+ *   header   "BTRACE1\0", uint32 version (1), uint32 columns
+ *   block    "BTB1", uint32 payload bytes, uint32 rows, uint32 0,
+ *            double key min, double key max, payload
+ *   ...
+ *   index    per block: uint64 offset, uint32 rows, uint32 0,
+ *            double key min, double key max
+ *   trailer  uint64 index offset, uint64 blocks, "BTIDX1\0\0"
+ * The index lets readers fetch only the blocks overlapping a key range.
+ * It is written on Close (); a file without one, e.g. from a crashed
+ * run, is indexed by walking the block headers, and the last incomplete
+ * block is dropped.  Nothing here depends on ns-3.
+ */
+class BinaryTrace
+{
+public:
+  static const uint32_t BLOCK_ROWS = 4096;
+  static const uint32_t MAX_COLUMNS = 16;
+  static const uint32_t HEADER_BYTES = 16;
+  static const uint32_t BLOCK_HEADER_BYTES = 32;
+  static const uint32_t INDEX_ENTRY_BYTES = 32;
+  static const uint32_t TRAILER_BYTES = 24;
+
+  /// Location and key range of one block
+  struct Block
+  {
+    uint64_t offset;
+    uint32_t rows;
+    double keyMin;
+    double keyMax;
+  };
+
+  static void PutU32 (std::string &out, uint32_t v)
+  {
+    for (uint32_t i = 0; i < 4; i++)
+      {
+        out.push_back (static_cast<char> (v >> (8 * i)));
+      }
+  }
+
+  static void PutU64 (std::string &out, uint64_t v)
+  {
+    for (uint32_t i = 0; i < 8; i++)
+      {
+        out.push_back (static_cast<char> (v >> (8 * i)));
+      }
+  }
+
+  static void PutDouble (std::string &out, double v)
+  {
+    uint64_t bits;
+    std::memcpy (&bits, &v, sizeof (bits));
+    PutU64 (out, bits);
+  }
+
+  static uint32_t GetU32 (const unsigned char *p)
+  {
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < 4; i++)
+      {
+        v |= static_cast<uint32_t> (p[i]) << (8 * i);
+      }
+    return v;
+  }
+
+  static uint64_t GetU64 (const unsigned char *p)
+  {
+    uint64_t v = 0;
+    for (uint32_t i = 0; i < 8; i++)
+      {
+        v |= static_cast<uint64_t> (p[i]) << (8 * i);
+      }
+    return v;
+  }
+
+  static double GetDouble (const unsigned char *p)
+  {
+    uint64_t bits = GetU64 (p);
+    double v;
+    std::memcpy (&v, &bits, sizeof (v));
+    return v;
+  }
+
+  static void PutVarint (std::string &out, int64_t v)
+  {
+    uint64_t u = (static_cast<uint64_t> (v) << 1) ^ static_cast<uint64_t> (v >> 63);
+    while (u >= 0x80)
+      {
+        out.push_back (static_cast<char> (u | 0x80));
+        u >>= 7;
+      }
+    out.push_back (static_cast<char> (u));
+  }
+
+  /// Decode a varint at *p, not reading past end; false if it is cut off
+  static bool GetVarint (const unsigned char **p, const unsigned char *end, int64_t *v)
+  {
+    uint64_t u = 0;
+    for (uint32_t shift = 0; *p < end && shift < 64; shift += 7)
+      {
+        unsigned char byte = *(*p)++;
+        u |= static_cast<uint64_t> (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          {
+            *v = static_cast<int64_t> (u >> 1) ^ -static_cast<int64_t> (u & 1);
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /**
+   * Smallest decimal exponent that represents every value closely
+   * enough, and at which no scaled value exceeds 1e18
+   */
+  static uint32_t Decimals (const double *values, uint32_t n, uint32_t stride)
+  {
+    double largest = 0;
+    for (uint32_t i = 0; i < n; i++)
+      {
+        largest = std::max (largest, std::fabs (values[i * stride]));
+      }
+    uint32_t d = 0;
+    for (; d < 9 && largest * std::pow (10.0, static_cast<int> (d + 1)) < 1e18; d++)
+      {
+        double scale = std::pow (10.0, static_cast<int> (d));
+        bool exact = true;
+        for (uint32_t i = 0; i < n && exact; i++)
+          {
+            double v = values[i * stride];
+            exact = std::fabs (std::floor (v * scale + 0.5) / scale - v) <= 1e-12 * std::fabs (v);
+          }
+        if (exact)
+          {
+            return d;
+          }
+      }
+    return d;
+  }
+};
+
+/**
+ * Read the index of a .bintrace file and decode blocks on demand.
+ */
+class BinaryTraceReader
+{
+public:
+  BinaryTraceReader ()
+    : m_file (0),
+      m_columns (0),
+      m_indexed (false),
+      m_end (0)
+  {
+  }
+
+  ~BinaryTraceReader ()
+  {
+    if (m_file)
+      {
+        std::fclose (m_file);
+      }
+  }
+
+  /// Open filename and load or rebuild its index; false if it is not a trace
+  bool Open (const std::string &filename)
+  {
+    m_file = std::fopen (filename.c_str (), "rb");
+    if (!m_file)
+      {
+        return false;
+      }
+    unsigned char header[BinaryTrace::HEADER_BYTES];
+    if (std::fread (header, 1, sizeof (header), m_file) != sizeof (header)
+        || std::memcmp (header, "BTRACE1", 8) != 0 || BinaryTrace::GetU32 (header + 8) != 1)
+      {
+        return false;
+      }
+    m_columns = BinaryTrace::GetU32 (header + 12);
+    if (m_columns == 0 || m_columns > BinaryTrace::MAX_COLUMNS)
+      {
+        return false;
+      }
+    std::fseek (m_file, 0, SEEK_END);
+    uint64_t size = std::ftell (m_file);
+    m_indexed = ReadIndex (size);
+    if (!m_indexed)
+      {
+        ScanBlocks (size);
+      }
+    return true;
+  }
+
+  uint32_t GetColumns (void) const
+  {
+    return m_columns;
+  }
+
+  /// Whether the file had an index, rather than one rebuilt by a scan
+  bool IsIndexed (void) const
+  {
+    return m_indexed;
+  }
+
+  /// End of the last complete block, where an appender continues
+  uint64_t GetDataEnd (void) const
+  {
+    return m_end;
+  }
+
+  const std::vector<BinaryTrace::Block> &GetBlocks (void) const
+  {
+    return m_blocks;
+  }
+
+  /// Decode block i into rows, GetColumns () values per row
+  bool ReadBlock (uint32_t i, std::vector<double> *rows)
+  {
+    const BinaryTrace::Block &block = m_blocks[i];
+    unsigned char header[BinaryTrace::BLOCK_HEADER_BYTES];
+    if (std::fseek (m_file, block.offset, SEEK_SET) != 0
+        || std::fread (header, 1, sizeof (header), m_file) != sizeof (header))
+      {
+        return false;
+      }
+    std::vector<unsigned char> payload (BinaryTrace::GetU32 (header + 4));
+    if (payload.empty ()
+        || std::fread (&payload[0], 1, payload.size (), m_file) != payload.size ())
+      {
+        return false;
+      }
+    const unsigned char *p = &payload[0];
+    const unsigned char *end = p + payload.size ();
+    rows->assign (static_cast<size_t> (block.rows) * m_columns, 0);
+    for (uint32_t c = 0; c < m_columns; c++)
+      {
+        if (p == end || *p > 9)
+          {
+            return false;
+          }
+        double scale = std::pow (10.0, static_cast<int> (*p++));
+        int64_t value = 0;
+        for (uint32_t r = 0; r < block.rows; r++)
+          {
+            int64_t delta;
+            if (!BinaryTrace::GetVarint (&p, end, &delta))
+              {
+                return false;
+              }
+            value += delta;
+            (*rows)[static_cast<size_t> (r) * m_columns + c] = value / scale;
+          }
+      }
+    return true;
+  }
+
+private:
+  bool ReadIndex (uint64_t size)
+  {
+    unsigned char trailer[BinaryTrace::TRAILER_BYTES];
+    if (size < BinaryTrace::HEADER_BYTES + BinaryTrace::TRAILER_BYTES
+        || std::fseek (m_file, size - BinaryTrace::TRAILER_BYTES, SEEK_SET) != 0
+        || std::fread (trailer, 1, sizeof (trailer), m_file) != sizeof (trailer)
+        || std::memcmp (trailer + 16, "BTIDX1\0\0", 8) != 0)
+      {
+        return false;
+      }
+    uint64_t offset = BinaryTrace::GetU64 (trailer);
+    uint64_t blocks = BinaryTrace::GetU64 (trailer + 8);
+    if (offset < BinaryTrace::HEADER_BYTES
+        || offset + blocks * BinaryTrace::INDEX_ENTRY_BYTES + BinaryTrace::TRAILER_BYTES != size)
+      {
+        return false;
+      }
+    std::vector<unsigned char> index (blocks * BinaryTrace::INDEX_ENTRY_BYTES);
+    if (std::fseek (m_file, offset, SEEK_SET) != 0
+        || (!index.empty () && std::fread (&index[0], 1, index.size (), m_file) != index.size ()))
+      {
+        return false;
+      }
+    m_blocks.clear ();
+    for (uint64_t i = 0; i < blocks; i++)
+      {
+        const unsigned char *e = &index[i * BinaryTrace::INDEX_ENTRY_BYTES];
+        BinaryTrace::Block block;
+        block.offset = BinaryTrace::GetU64 (e);
+        block.rows = BinaryTrace::GetU32 (e + 8);
+        block.keyMin = BinaryTrace::GetDouble (e + 16);
+        block.keyMax = BinaryTrace::GetDouble (e + 24);
+        m_blocks.push_back (block);
+      }
+    m_end = offset;
+    return true;
+  }
+
+  // Walk the block headers from the start of the file
+  void ScanBlocks (uint64_t size)
+  {
+    m_blocks.clear ();
+    uint64_t offset = BinaryTrace::HEADER_BYTES;
+    unsigned char header[BinaryTrace::BLOCK_HEADER_BYTES];
+    while (offset + BinaryTrace::BLOCK_HEADER_BYTES <= size
+           && std::fseek (m_file, offset, SEEK_SET) == 0
+           && std::fread (header, 1, sizeof (header), m_file) == sizeof (header)
+           && std::memcmp (header, "BTB1", 4) == 0)
+      {
+        uint64_t next = offset + BinaryTrace::BLOCK_HEADER_BYTES + BinaryTrace::GetU32 (header + 4);
+        if (next > size)
+          {
+            break;
+          }
+        BinaryTrace::Block block;
+        block.offset = offset;
+        block.rows = BinaryTrace::GetU32 (header + 8);
+        block.keyMin = BinaryTrace::GetDouble (header + 16);
+        block.keyMax = BinaryTrace::GetDouble (header + 24);
+        m_blocks.push_back (block);
+        offset = next;
+      }
+    m_end = offset;
+  }
+
+  std::FILE *m_file;
+  uint32_t m_columns;
+  bool m_indexed;
+  uint64_t m_end;
+  std::vector<BinaryTrace::Block> m_blocks;
+};
+
+/**
+ * Write rows to a .bintrace file.
+ */
+class BinaryTraceWriter
+{
+public:
+  BinaryTraceWriter ()
+    : m_file (0),
+      m_columns (0),
+      m_offset (0)
+  {
+  }
+
+  ~BinaryTraceWriter ()
+  {
+    Close ();
+  }
+
+  /**
+   * Create filename, or with append continue an existing trace of the
+   * same number of columns after its last complete block.
+   *
+   * \return false if the file cannot be written or is a different trace
+   */
+  bool Open (const std::string &filename, uint32_t columns, bool append)
+  {
+    if (columns == 0 || columns > BinaryTrace::MAX_COLUMNS)
+      {
+        return false;
+      }
+    m_columns = columns;
+    if (append && access (filename.c_str (), F_OK) == 0)
+      {
+        BinaryTraceReader existing;
+        if (!existing.Open (filename) || existing.GetColumns () != columns)
+          {
+            return false;
+          }
+        m_blocks = existing.GetBlocks ();
+        m_offset = existing.GetDataEnd ();
+        m_file = std::fopen (filename.c_str (), "r+b");
+        if (!m_file || ftruncate (fileno (m_file), m_offset) != 0)
+          {
+            return false;
+          }
+        std::fseek (m_file, m_offset, SEEK_SET);
+        return true;
+      }
+    m_file = std::fopen (filename.c_str (), "wb");
+    if (!m_file)
+      {
+        return false;
+      }
+    std::string header ("BTRACE1", 8);
+    BinaryTrace::PutU32 (header, 1);
+    BinaryTrace::PutU32 (header, columns);
+    m_offset = header.size ();
+    return std::fwrite (header.data (), 1, header.size (), m_file) == header.size ();
+  }
+
+  /// Add a row of GetColumns () values
+  void Add (const double *row)
+  {
+    m_rows.insert (m_rows.end (), row, row + m_columns);
+    if (m_rows.size () == static_cast<size_t> (BinaryTrace::BLOCK_ROWS) * m_columns)
+      {
+        Flush ();
+      }
+  }
+
+  /// Write the rows added so far as a block
+  void Flush (void)
+  {
+    uint32_t n = m_rows.size () / m_columns;
+    if (n == 0)
+      {
+        return;
+      }
+    BinaryTrace::Block block;
+    block.offset = m_offset;
+    block.rows = n;
+    block.keyMin = m_rows[0];
+    block.keyMax = m_rows[0];
+    for (uint32_t r = 1; r < n; r++)
+      {
+        block.keyMin = std::min (block.keyMin, m_rows[r * m_columns]);
+        block.keyMax = std::max (block.keyMax, m_rows[r * m_columns]);
+      }
+    m_payload.clear ();
+    for (uint32_t c = 0; c < m_columns; c++)
+      {
+        uint32_t d = BinaryTrace::Decimals (&m_rows[c], n, m_columns);
+        double scale = std::pow (10.0, static_cast<int> (d));
+        m_payload.push_back (static_cast<char> (d));
+        int64_t previous = 0;
+        for (uint32_t r = 0; r < n; r++)
+          {
+            int64_t value = static_cast<int64_t> (std::floor (m_rows[r * m_columns + c] * scale + 0.5));
+            BinaryTrace::PutVarint (m_payload, value - previous);
+            previous = value;
+          }
+      }
+    m_text.assign ("BTB1", 4);
+    BinaryTrace::PutU32 (m_text, m_payload.size ());
+    BinaryTrace::PutU32 (m_text, n);
+    BinaryTrace::PutU32 (m_text, 0);
+    BinaryTrace::PutDouble (m_text, block.keyMin);
+    BinaryTrace::PutDouble (m_text, block.keyMax);
+    m_text.append (m_payload);
+    std::fwrite (m_text.data (), 1, m_text.size (), m_file);
+    m_offset += m_text.size ();
+    m_blocks.push_back (block);
+    m_rows.clear ();
+  }
+
+  /// Write the remaining rows and the index, and close the file
+  void Close (void)
+  {
+    if (!m_file)
+      {
+        return;
+      }
+    Flush ();
+    m_text.clear ();
+    for (uint32_t i = 0; i < m_blocks.size (); i++)
+      {
+        BinaryTrace::PutU64 (m_text, m_blocks[i].offset);
+        BinaryTrace::PutU32 (m_text, m_blocks[i].rows);
+        BinaryTrace::PutU32 (m_text, 0);
+        BinaryTrace::PutDouble (m_text, m_blocks[i].keyMin);
+        BinaryTrace::PutDouble (m_text, m_blocks[i].keyMax);
+      }
+    BinaryTrace::PutU64 (m_text, m_offset);
+    BinaryTrace::PutU64 (m_text, m_blocks.size ());
+    m_text.append ("BTIDX1\0\0", 8);
+    std::fwrite (m_text.data (), 1, m_text.size (), m_file);
+    std::fclose (m_file);
+    m_file = 0;
+  }
+
+  uint32_t GetColumns (void) const
+  {
+    return m_columns;
+  }
+
+private:
+  std::FILE *m_file;
+  uint32_t m_columns;
+  uint64_t m_offset;                      //!< end of the last block written
+  std::vector<BinaryTrace::Block> m_blocks;
+  std::vector<double> m_rows;             //!< rows of the open block
+  std::string m_payload;
+  std::string m_text;
+};
+
+#endif /* BINARY_TRACE_H */
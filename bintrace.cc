@@ -0,0 +1,205 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+// Inspect and convert .bintrace files.
+//
+//   bintrace info <file.bintrace>
+//   bintrace text <file.bintrace> [from [to]]
+//   bintrace convert <file.plotme> <file.bintrace>
+//
+// info prints the columns, rows, blocks, key range and bytes per row.
+// text prints the rows whose key (first column) lies in [from, to] as
+// space-separated text; only the blocks whose key range overlaps it are
+// read.  convert turns a whitespace-separated text trace into a binary
+// one; lines starting with '#' and empty lines are skipped, and every
+// other line must hold the same number of numbers.  The tool does not
+// need ns-3; it can be built with
+//   g++ -std=c++11 -O2 -o bintrace bintrace.cc
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "binary-trace.h"
+
+static int
+Info (const std::string &filename)
+{
+  BinaryTraceReader reader;
+  if (!reader.Open (filename))
+    {
+      std::fprintf (stderr, "%s is not a binary trace\n", filename.c_str ());
+      return 1;
+    }
+  const std::vector<BinaryTrace::Block> &blocks = reader.GetBlocks ();
+  uint64_t rows = 0;
+  double keyMin = std::numeric_limits<double>::infinity ();
+  double keyMax = -keyMin;
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      rows += blocks[i].rows;
+      keyMin = std::min (keyMin, blocks[i].keyMin);
+      keyMax = std::max (keyMax, blocks[i].keyMax);
+    }
+  std::printf ("columns %u\nrows %llu\nblocks %zu%s\n", reader.GetColumns (),
+               static_cast<unsigned long long> (rows), blocks.size (),
+               reader.IsIndexed () ? "" : " (no index, rebuilt by scanning)");
+  if (rows > 0)
+    {
+      std::printf ("key %.10g to %.10g\nbytes/row %.2f\n", keyMin, keyMax,
+                   static_cast<double> (reader.GetDataEnd ()) / rows);
+    }
+  return 0;
+}
+
+static int
+Text (const std::string &filename, double from, double to)
+{
+  BinaryTraceReader reader;
+  if (!reader.Open (filename))
+    {
+      std::fprintf (stderr, "%s is not a binary trace\n", filename.c_str ());
+      return 1;
+    }
+  uint32_t columns = reader.GetColumns ();
+  const std::vector<BinaryTrace::Block> &blocks = reader.GetBlocks ();
+  std::vector<double> rows;
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      if (blocks[i].keyMax < from || blocks[i].keyMin > to)
+        {
+          continue;
+        }
+      if (!reader.ReadBlock (i, &rows))
+        {
+          std::fprintf (stderr, "%s: block %u is damaged\n", filename.c_str (), i);
+          return 1;
+        }
+      for (size_t r = 0; r < rows.size (); r += columns)
+        {
+          if (rows[r] < from || rows[r] > to)
+            {
+              continue;
+            }
+          for (uint32_t c = 0; c < columns; c++)
+            {
+              std::printf (c ? " %.10g" : "%.10g", rows[r + c]);
+            }
+          std::printf ("\n");
+        }
+    }
+  return 0;
+}
+
+static int
+Convert (const std::string &input, const std::string &output)
+{
+  std::ifstream in (input.c_str ());
+  if (!in)
+    {
+      std::fprintf (stderr, "Cannot open %s\n", input.c_str ());
+      return 1;
+    }
+  BinaryTraceWriter writer;
+  std::string line;
+  uint64_t lineNumber = 0;
+  std::vector<double> row;
+  while (std::getline (in, line))
+    {
+      lineNumber++;
+      std::string::size_type first = line.find_first_not_of (" \t\r");
+      if (first == std::string::npos || line[first] == '#')
+        {
+          continue;
+        }
+      std::istringstream fields (line);
+      row.clear ();
+      std::string field;
+      while (fields >> field)
+        {
+          char *end;
+          double value = std::strtod (field.c_str (), &end);
+          if (*end != '\0')
+            {
+              std::fprintf (stderr, "%s:%llu: %s is not a number\n", input.c_str (),
+                            static_cast<unsigned long long> (lineNumber), field.c_str ());
+              return 1;
+            }
+          row.push_back (value);
+        }
+      if (writer.GetColumns () == 0 && !writer.Open (output, row.size (), false))
+        {
+          std::fprintf (stderr, "Cannot write %s\n", output.c_str ());
+          return 1;
+        }
+      if (row.size () != writer.GetColumns ())
+        {
+          std::fprintf (stderr, "%s:%llu: %zu columns, expected %u\n", input.c_str (),
+                        static_cast<unsigned long long> (lineNumber), row.size (), writer.GetColumns ());
+          return 1;
+        }
+      writer.Add (&row[0]);
+    }
+  if (writer.GetColumns () == 0)
+    {
+      std::fprintf (stderr, "%s has no rows\n", input.c_str ());
+      return 1;
+    }
+  writer.Close ();
+  return 0;
+}
+
+// Read a whole argument as a number
+static bool
+ParseDouble (const char *arg, double &value)
+{
+  char *end;
+  value = std::strtod (arg, &end);
+  return end != arg && *end == '\0';
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string command = argc > 1 ? argv[1] : "";
+  if (command == "info" && argc == 3)
+    {
+      return Info (argv[2]);
+    }
+  double from = -std::numeric_limits<double>::infinity ();
+  double to = std::numeric_limits<double>::infinity ();
+  if (command == "text" && argc >= 3 && argc <= 5
+      && (argc <= 3 || ParseDouble (argv[3], from)) && (argc <= 4 || ParseDouble (argv[4], to)))
+    {
+      return Text (argv[2], from, to);
+    }
+  if (command == "convert" && argc == 4)
+    {
+      return Convert (argv[2], argv[3]);
+    }
+  std::fprintf (stderr, "usage: %s info <file.bintrace>\n"
+                "       %s text <file.bintrace> [from [to]]\n"
+                "       %s convert <file.plotme> <file.bintrace>\n", argv[0], argv[0], argv[0]);
+  return 1;
+}
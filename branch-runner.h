@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef BRANCH_RUNNER_H
+#define BRANCH_RUNNER_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/abort.h"
+#include "parallel-runner.h"
+#include "run-stats.h"
+
+namespace ns3 {
+
+/**
+ * Run what-if variants of one simulation from a shared checkpoint.
+ *
+ * The simulation runs once up to the checkpoint, stopping right before
+ * the events scheduled at the checkpoint itself.  Every branch then runs
+ * in a child process forked from that state, with its own copy of the
+ * simulator, the nodes and the event queue; memory is shared
+ * copy-on-write until a branch modifies it.  The branch applies its
+ * change, runs the simulation on, calls Simulator::Destroy () and
+ * returns its result as text, as a ParallelRunner job.  The parent keeps
+ * the checkpoint state and should destroy it once the branches are done.
+ *
+ * Only the forking thread survives in a child, and files and
+ * shared-memory segments opened before the checkpoint are shared by all
+ * branches, so per-change trace recorders must not be running at the
+ * checkpoint and every branch must write to its own output files.
+ */
+class BranchRunner
+{
+public:
+  /// A branch maps a branch index to its result text
+  typedef ParallelRunner::Job Branch;
+
+  /**
+   * \param maxWorkers maximum number of concurrent branches;
+   *        0 uses one per online core
+   */
+  BranchRunner (uint32_t maxWorkers)
+    : m_runner (maxWorkers),
+      m_prefixWall (0)
+  {
+  }
+
+  /**
+   * Run up to checkpoint, then branches 0 .. nBranches - 1 from there,
+   * and return their results in branch order.
+   */
+  std::vector<std::string> Run (Time checkpoint, uint32_t nBranches, Branch branch)
+  {
+    NS_ABORT_MSG_IF (checkpoint < Simulator::Now (), "Checkpoint " << checkpoint.GetSeconds ()
+                     << " s is in the past");
+    RunStats runStats;
+    if (checkpoint > Simulator::Now ())
+      {
+        Time stop = checkpoint - TimeStep (1);
+        Simulator::Stop (stop - Simulator::Now ());
+        Simulator::Run ();
+        NS_ABORT_MSG_IF (Simulator::Now () < stop, "The simulation ended at " << Simulator::Now ().GetSeconds ()
+                         << " s, before the checkpoint");
+      }
+    m_prefixWall = runStats.GetWallSeconds ();
+    return m_runner.Run (nBranches, branch);
+  }
+
+  /// Wall-clock seconds spent running up to the checkpoint
+  double GetPrefixSeconds (void) const
+  {
+    return m_prefixWall;
+  }
+
+  /**
+   * Split a variant list "a=1,b=2;c=3" into variants and their
+   * "name=value" changes; an empty variant changes nothing.
+   */
+  static std::vector<std::vector<std::pair<std::string, std::string> > > ParseVariants (const std::string &text)
+  {
+    std::vector<std::vector<std::pair<std::string, std::string> > > variants;
+    std::istringstream list (text);
+    std::string variant;
+    while (std::getline (list, variant, ';'))
+      {
+        variants.push_back (std::vector<std::pair<std::string, std::string> > ());
+        std::istringstream changes (variant);
+        std::string change;
+        while (std::getline (changes, change, ','))
+          {
+            std::string::size_type eq = change.find ('=');
+            NS_ABORT_MSG_IF (eq == std::string::npos || eq == 0, "Bad change \"" << change << "\" in variant \""
+                             << variant << "\"; expected name=value");
+            variants.back ().push_back (std::make_pair (change.substr (0, eq), change.substr (eq + 1)));
+          }
+      }
+    return variants;
+  }
+
+private:
+  ParallelRunner m_runner;
+  double m_prefixWall;
+};
+
+} // namespace ns3
+
+#endif /* BRANCH_RUNNER_H */
@@ -0,0 +1,433 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef DECIMATED_PLOT_H
+#define DECIMATED_PLOT_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/gnuplot.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * Gnuplot script of long traces, decimated to the resolution of the
+ * image.
+ *
+ * Trace sinks add (x, y) points to one or more series.  Write () reduces
+ * every series to at most four points per pixel column and writes
+ * <prefix>.plt, a gnuplot script with the data inline that renders
+ * <prefix>.png, so plotting takes time proportional to the image width
+ * rather than to the length of the run.  Two reductions are available:
+ *  - MIN_MAX splits the x range into one bucket per pixel column and
+ *    keeps the first, last, minimum and maximum point of each (M4), so
+ *    every spike and the envelope of the trace survive exactly;
+ *  - LTTB (largest triangle three buckets) keeps, per bucket, the point
+ *    that forms the largest triangle with its chosen neighbours, which
+ *    follows the visual shape with fewer points.
+ * Series shorter than the limit are written unchanged.
+ *
+ * Points are decimated as they arrive, so memory does not grow with the
+ * length of the run.  The first 4 * width points of a series are kept
+ * as they are and fix a time bucket of 1 / width of their x range; from
+ * then on every bucket keeps only its first, last, minimum and maximum
+ * point, and when the x range reaches 2 * width buckets their width
+ * doubles and neighbouring buckets merge.  Write () applies the chosen
+ * reduction to these at most 8 * width points; the extremes LTTB picks
+ * from are among them.
+ */
+class DecimatedPlot : public SimpleRefCount<DecimatedPlot>
+{
+public:
+  enum Method
+  {
+    MIN_MAX,
+    LTTB
+  };
+
+  typedef std::pair<double, double> Point;
+
+  /**
+   * \param prefix name of the script and the image without extension
+   * \param title plot title
+   * \param xLegend label of the x axis
+   * \param yLegend label of the y axis
+   * \param method reduction applied to every series
+   * \param width image width in pixels
+   * \param height image height in pixels
+   */
+  DecimatedPlot (std::string prefix, std::string title, std::string xLegend, std::string yLegend,
+                 Method method = MIN_MAX, uint32_t width = 1280, uint32_t height = 720)
+    : m_prefix (prefix),
+      m_title (title),
+      m_xLegend (xLegend),
+      m_yLegend (yLegend),
+      m_method (method),
+      m_width (width),
+      m_height (height),
+      m_written (false)
+  {
+    NS_ABORT_MSG_UNLESS (width > 0 && height > 0, "Plot size must be positive");
+  }
+
+  /// Add a series and return its index
+  uint32_t AddSeries (std::string title, Gnuplot2dDataset::Style style = Gnuplot2dDataset::LINES)
+  {
+    m_series.push_back (Series ());
+    m_series.back ().title = title;
+    m_series.back ().style = style;
+    return m_series.size () - 1;
+  }
+
+  /// Add a point; x must not decrease within a series
+  void Add (uint32_t series, double x, double y)
+  {
+    Series &s = m_series[series];
+    if (s.step > 0)
+      {
+        AddToBin (s, Point (x, y));
+        return;
+      }
+    s.points.push_back (Point (x, y));
+    if (s.points.size () > 4 * static_cast<size_t> (m_width))
+      {
+        StartBins (s);
+      }
+  }
+
+  /// Add a point at the current simulated time in seconds
+  void Record (uint32_t series, double y)
+  {
+    Add (series, Simulator::Now ().GetSeconds (), y);
+  }
+
+  /// Write <prefix>.plt when Simulator::Destroy () runs
+  void WriteOnDestroy (void)
+  {
+    Simulator::ScheduleDestroy (&DecimatedPlot::Write, Ptr<DecimatedPlot> (this));
+  }
+
+  /// Decimate every series and write <prefix>.plt; only the first call writes
+  void Write (void)
+  {
+    if (m_written)
+      {
+        return;
+      }
+    m_written = true;
+    std::ostringstream terminal;
+    terminal << "png size " << m_width << "," << m_height;
+    Gnuplot plot (m_prefix + ".png", m_title);
+    plot.SetTerminal (terminal.str ());
+    plot.SetLegend (m_xLegend, m_yLegend);
+    uint32_t limit = 4 * m_width;
+    for (uint32_t i = 0; i < m_series.size (); i++)
+      {
+        std::vector<Point> kept = Kept (m_series[i]);
+        std::vector<Point> points = m_method == MIN_MAX ? MinMax (kept, m_width) : Lttb (kept, limit);
+        Gnuplot2dDataset dataset (m_series[i].title);
+        dataset.SetStyle (m_series[i].style);
+        for (uint32_t j = 0; j < points.size (); j++)
+          {
+            dataset.Add (points[j].first, points[j].second);
+          }
+        plot.AddDataset (dataset);
+        std::vector<Point> ().swap (m_series[i].points);
+        std::vector<Bin> ().swap (m_series[i].bins);
+      }
+    std::string filename = m_prefix + ".plt";
+    std::ofstream out (filename.c_str (), std::ios::out | std::ios::trunc);
+    plot.GenerateOutput (out);
+    NS_ABORT_MSG_UNLESS (out.flush (), "Cannot write " << filename);
+  }
+
+  /// Method named "minmax" or "lttb"
+  static Method ParseMethod (std::string name)
+  {
+    if (name == "minmax")
+      {
+        return MIN_MAX;
+      }
+    NS_ABORT_MSG_UNLESS (name == "lttb", "Unknown plot decimation " << name << " (minmax, lttb)");
+    return LTTB;
+  }
+
+  /**
+   * Keep the first, last, minimum and maximum point of each of buckets
+   * equal slices of the x range, in their original order.
+   */
+  static std::vector<Point> MinMax (const std::vector<Point> &points, uint32_t buckets)
+  {
+    if (points.size () <= 4 * static_cast<size_t> (buckets))
+      {
+        return points;
+      }
+    double x0 = points.front ().first;
+    double span = points.back ().first - x0;
+    std::vector<Point> out;
+    out.reserve (4 * static_cast<size_t> (buckets));
+    size_t begin = 0;
+    while (begin < points.size ())
+      {
+        uint32_t bucket = Bucket (points[begin].first, x0, span, buckets);
+        size_t end = begin + 1;
+        size_t lo = begin;
+        size_t hi = begin;
+        while (end < points.size () && Bucket (points[end].first, x0, span, buckets) == bucket)
+          {
+            if (points[end].second < points[lo].second)
+              {
+                lo = end;
+              }
+            if (points[end].second > points[hi].second)
+              {
+                hi = end;
+              }
+            end++;
+          }
+        size_t keep[4] = { begin, std::min (lo, hi), std::max (lo, hi), end - 1 };
+        for (uint32_t k = 0; k < 4; k++)
+          {
+            if (k == 0 || keep[k] != keep[k - 1])
+              {
+                out.push_back (points[keep[k]]);
+              }
+          }
+        begin = end;
+      }
+    return out;
+  }
+
+  /**
+   * Largest-triangle-three-buckets reduction to at most threshold points;
+   * the first and last point are always kept.
+   */
+  static std::vector<Point> Lttb (const std::vector<Point> &points, uint32_t threshold)
+  {
+    size_t n = points.size ();
+    if (threshold < 3 || n <= threshold)
+      {
+        return points;
+      }
+    std::vector<Point> out;
+    out.reserve (threshold);
+    out.push_back (points[0]);
+    // The points between the first and the last split into threshold - 2 buckets
+    double every = static_cast<double> (n - 2) / (threshold - 2);
+    size_t a = 0;
+    for (uint32_t i = 0; i < threshold - 2; i++)
+      {
+        // Average of the next bucket, or the last point after the final one
+        size_t nextBegin = static_cast<size_t> ((i + 1) * every) + 1;
+        size_t nextEnd = std::min (static_cast<size_t> ((i + 2) * every) + 1, n);
+        if (nextBegin >= nextEnd)
+          {
+            nextBegin = n - 1;
+            nextEnd = n;
+          }
+        double avgX = 0;
+        double avgY = 0;
+        for (size_t j = nextBegin; j < nextEnd; j++)
+          {
+            avgX += points[j].first;
+            avgY += points[j].second;
+          }
+        avgX /= nextEnd - nextBegin;
+        avgY /= nextEnd - nextBegin;
+
+        size_t begin = static_cast<size_t> (i * every) + 1;
+        size_t end = std::min (static_cast<size_t> ((i + 1) * every) + 1, n - 1);
+        size_t best = begin;
+        double bestArea = -1;
+        for (size_t j = begin; j < end; j++)
+          {
+            double area = std::fabs ((points[a].first - avgX) * (points[j].second - points[a].second)
+                                     - (points[a].first - points[j].first) * (avgY - points[a].second));
+            if (area > bestArea)
+              {
+                bestArea = area;
+                best = j;
+              }
+          }
+        out.push_back (points[best]);
+        a = best;
+      }
+    out.push_back (points[n - 1]);
+    return out;
+  }
+
+private:
+  // First, last, minimum and maximum point of one time bucket
+  struct Bin
+  {
+    uint64_t index;
+    Point first;
+    Point lo;
+    Point hi;
+    Point last;
+  };
+
+  struct Series
+  {
+    Series ()
+      : style (Gnuplot2dDataset::LINES),
+        x0 (0),
+        step (0)
+    {
+    }
+
+    std::string title;
+    Gnuplot2dDataset::Style style;
+    std::vector<Point> points;      //!< raw points until step is fixed
+    std::vector<Bin> bins;
+    double x0;                      //!< x of the start of bin 0
+    double step;                    //!< bin width; 0 while points are kept raw
+  };
+
+  // Fix the bin width from the raw points and move them into bins.  If
+  // they all share one x there is no width yet; keep their extremes.
+  void StartBins (Series &s)
+  {
+    double span = s.points.back ().first - s.points.front ().first;
+    if (span <= 0)
+      {
+        s.points = MinMax (s.points, 1);
+        return;
+      }
+    s.x0 = s.points.front ().first;
+    s.step = span / m_width;
+    std::vector<Point> points;
+    points.swap (s.points);
+    for (size_t i = 0; i < points.size (); i++)
+      {
+        AddToBin (s, points[i]);
+      }
+  }
+
+  void AddToBin (Series &s, const Point &p)
+  {
+    double position = std::max (0.0, (p.first - s.x0) / s.step);
+    while (position >= 2.0 * m_width)
+      {
+        Coarsen (s);
+        position = std::max (0.0, (p.first - s.x0) / s.step);
+      }
+    uint64_t index = static_cast<uint64_t> (position);
+    if (s.bins.empty () || s.bins.back ().index != index)
+      {
+        Bin bin = { index, p, p, p, p };
+        s.bins.push_back (bin);
+        return;
+      }
+    Merge (s.bins.back (), p, p, p);
+  }
+
+  // Double the bin width, merging every pair of bins
+  static void Coarsen (Series &s)
+  {
+    s.step *= 2;
+    size_t n = 0;
+    for (size_t i = 0; i < s.bins.size (); i++)
+      {
+        Bin bin = s.bins[i];
+        bin.index /= 2;
+        if (n > 0 && s.bins[n - 1].index == bin.index)
+          {
+            Merge (s.bins[n - 1], bin.lo, bin.hi, bin.last);
+          }
+        else
+          {
+            s.bins[n++] = bin;
+          }
+      }
+    s.bins.resize (n);
+  }
+
+  static void Merge (Bin &bin, const Point &lo, const Point &hi, const Point &last)
+  {
+    if (lo.second < bin.lo.second)
+      {
+        bin.lo = lo;
+      }
+    if (hi.second > bin.hi.second)
+      {
+        bin.hi = hi;
+      }
+    bin.last = last;
+  }
+
+  // Points kept of a series, in x order
+  static std::vector<Point> Kept (const Series &s)
+  {
+    if (s.step <= 0)
+      {
+        return s.points;
+      }
+    std::vector<Point> out;
+    out.reserve (4 * s.bins.size ());
+    for (size_t i = 0; i < s.bins.size (); i++)
+      {
+        const Bin &bin = s.bins[i];
+        bool loFirst = bin.lo.first <= bin.hi.first;
+        Point keep[4] = { bin.first, loFirst ? bin.lo : bin.hi, loFirst ? bin.hi : bin.lo, bin.last };
+        for (uint32_t k = 0; k < 4; k++)
+          {
+            if (k == 0 || keep[k] != keep[k - 1])
+              {
+                out.push_back (keep[k]);
+              }
+          }
+      }
+    return out;
+  }
+
+  static uint32_t Bucket (double x, double x0, double span, uint32_t buckets)
+  {
+    if (span <= 0)
+      {
+        return 0;
+      }
+    uint32_t bucket = static_cast<uint32_t> ((x - x0) / span * buckets);
+    return std::min (bucket, buckets - 1);
+  }
+
+  std::string m_prefix;
+  std::string m_title;
+  std::string m_xLegend;
+  std::string m_yLegend;
+  Method m_method;
+  uint32_t m_width;
+  uint32_t m_height;
+  std::vector<Series> m_series;
+  bool m_written;
+};
+
+} // namespace ns3
+
+#endif /* DECIMATED_PLOT_H */
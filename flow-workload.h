@@ -0,0 +1,378 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef FLOW_WORKLOAD_H
+#define FLOW_WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/node.h"
+#include "ns3/socket.h"
+#include "ns3/packet.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/tcp-l4-protocol.h"
+#include "ns3/object-vector.h"
+#include "ns3/double.h"
+#include "ns3/sequence-number.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/abort.h"
+#include "trace-recorder.h"
+#include "quantile-sketch.h"
+
+namespace ns3 {
+
+/**
+ * Open-loop workload of short TCP flows.
+ *
+ * Flows arrive with exponential inter-arrival times, each from a random
+ * sender to a random receiver, and carry a Pareto-distributed number of
+ * bytes: many short flows and a few long ones, as in web traffic.
+ * Arrivals do not wait for earlier flows to finish.
+ *
+ * No application is installed per flow.  Every receiver has one
+ * listening socket that drains and closes the connections it accepts,
+ * and the state of a flow in progress is a small slot that is reused
+ * once the flow completes.  The sender closes first, so TCP keeps its
+ * socket in TIME_WAIT for 2 * MaxSegLifetime before releasing it; with
+ * the default of 120 s that would hold every socket of the last four
+ * minutes, so workload sockets use a MaxSegLifetime of 0.5 s.  Memory
+ * therefore grows with the flows in progress, capped at maxActive
+ * (arrivals beyond it are rejected), and those closed in the last
+ * second, not with the number of flows started.  GetPeakSockets ()
+ * reports the most TCP sockets open at once on the senders and
+ * receivers, sampled every second.
+ *
+ * A flow completes when the last of its bytes is acknowledged, and fails
+ * if its connection cannot be set up or is aborted, for instance when
+ * its retransmissions run out.  Flow
+ * completion times (s) are kept in a QuantileSketch and, with
+ * SetRecorder (), written as (size in bytes, completion time) records.
+ */
+class FlowWorkload : public SimpleRefCount<FlowWorkload>
+{
+public:
+  /**
+   * \param arrivals inter-arrival times in seconds; its Mean sets the
+   *        arrival rate
+   * \param meanSize mean flow size in bytes before the bound
+   * \param shape Pareto shape, > 1; 1.2 is typical of web objects
+   * \param maxSize largest flow size in bytes
+   * \param port receiver port
+   * \param maxActive largest number of flows in progress
+   */
+  FlowWorkload (Ptr<RandomVariableStream> arrivals, double meanSize, double shape, double maxSize,
+                uint16_t port, uint32_t maxActive)
+    : m_arrivals (arrivals),
+      m_scale (meanSize * (shape - 1) / shape),
+      m_shape (shape),
+      m_maxSize (maxSize),
+      m_port (port),
+      m_maxActive (maxActive),
+      m_uniform (CreateObject<UniformRandomVariable> ()),
+      m_nextId (0),
+      m_started (0),
+      m_rejected (0),
+      m_failed (0),
+      m_active (0),
+      m_peakActive (0),
+      m_peakSockets (0)
+  {
+    NS_ABORT_MSG_UNLESS (shape > 1, "Pareto shape must be above 1 for a finite mean");
+    NS_ABORT_MSG_UNLESS (meanSize >= 1 && maxSize >= meanSize && maxSize < 2e9, "Bad flow size bounds");
+  }
+
+  /// Stream of the sender, receiver and size choices
+  void SetStream (int64_t stream)
+  {
+    m_uniform->SetStream (stream);
+  }
+
+  void AddSender (Ptr<Node> node)
+  {
+    m_senders.push_back (node);
+  }
+
+  /// Add a receiver and open its listening socket
+  void AddReceiver (Ptr<Node> node, Ipv4Address address)
+  {
+    Ptr<Socket> socket = Socket::CreateSocket (node, TcpSocketFactory::GetTypeId ());
+    NS_ABORT_MSG_IF (socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), m_port)) < 0,
+                     "Cannot bind port " << m_port);
+    socket->Listen ();
+    socket->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                               MakeCallback (&FlowWorkload::Accepted));
+    m_listeners.push_back (socket);
+    m_receivers.push_back (address);
+  }
+
+  /// Generate arrivals from start until stop
+  void Start (Time start, Time stop)
+  {
+    NS_ABORT_MSG_IF (m_senders.empty () || m_receivers.empty (), "The workload needs senders and receivers");
+    m_stop = stop;
+    Simulator::Schedule (start - Simulator::Now (), &FlowWorkload::Arrival, Ptr<FlowWorkload> (this));
+    Simulator::Schedule (start - Simulator::Now (), &FlowWorkload::CountSockets, Ptr<FlowWorkload> (this));
+  }
+
+  void SetRecorder (Ptr<TraceRecorder> recorder)
+  {
+    m_recorder = recorder;
+  }
+
+  uint64_t GetStarted (void) const
+  {
+    return m_started;
+  }
+
+  uint64_t GetRejected (void) const
+  {
+    return m_rejected;
+  }
+
+  /// Flows started whose connection failed or was aborted
+  uint64_t GetFailed (void) const
+  {
+    return m_failed;
+  }
+
+  uint32_t GetPeakActive (void) const
+  {
+    return m_peakActive;
+  }
+
+  /// Most TCP sockets open at once on the senders and receivers
+  uint32_t GetPeakSockets (void) const
+  {
+    return m_peakSockets;
+  }
+
+  /// Completion times of the flows completed so far, in seconds
+  const QuantileSketch &GetCompletionTimes (void) const
+  {
+    return m_fct;
+  }
+
+private:
+  // A flow in progress; id tells a slot's current flow from the earlier
+  // ones whose sockets still deliver callbacks
+  struct Flow
+  {
+    FlowWorkload *workload;
+    uint64_t id;
+    uint32_t size;
+    uint32_t queued;
+    Time start;
+    Ptr<Socket> socket;
+  };
+
+  void Arrival (void)
+  {
+    if (Simulator::Now () >= m_stop)
+      {
+        return;
+      }
+    Simulator::Schedule (Seconds (m_arrivals->GetValue ()), &FlowWorkload::Arrival, Ptr<FlowWorkload> (this));
+    if (m_active >= m_maxActive)
+      {
+        m_rejected++;
+        return;
+      }
+    if (m_free.empty ())
+      {
+        m_flows.push_back (Flow ());
+        m_free.push_back (&m_flows.back ());
+      }
+    Flow *flow = m_free.back ();
+    m_free.pop_back ();
+    m_active++;
+    m_peakActive = std::max (m_peakActive, m_active);
+
+    // Bounded Pareto by inversion
+    double size = m_scale / std::pow (1 - m_uniform->GetValue (), 1 / m_shape);
+    flow->workload = this;
+    flow->id = m_nextId++;
+    flow->size = static_cast<uint32_t> (std::max (1.0, std::min (size, m_maxSize)));
+    flow->queued = 0;
+    flow->start = Simulator::Now ();
+    Ptr<Node> sender = m_senders[m_uniform->GetInteger (0, m_senders.size () - 1)];
+    Ipv4Address receiver = m_receivers[m_uniform->GetInteger (0, m_receivers.size () - 1)];
+    flow->socket = Socket::CreateSocket (sender, TcpSocketFactory::GetTypeId ());
+    // Keep TIME_WAIT, 2 * MaxSegLifetime, short: the flow is done with it
+    flow->socket->SetAttribute ("MaxSegLifetime", DoubleValue (0.5));
+    if (flow->socket->Bind () < 0)
+      {
+        Abandon (flow);
+        return;
+      }
+    flow->socket->SetConnectCallback (MakeNullCallback<void, Ptr<Socket> > (),
+                                      MakeBoundCallback (&FlowWorkload::Failed, flow, flow->id));
+    flow->socket->SetCloseCallbacks (MakeNullCallback<void, Ptr<Socket> > (),
+                                     MakeBoundCallback (&FlowWorkload::Failed, flow, flow->id));
+    flow->socket->SetSendCallback (MakeBoundCallback (&FlowWorkload::SendMore, flow, flow->id));
+    flow->socket->TraceConnectWithoutContext ("HighestRxAck", MakeBoundCallback (&FlowWorkload::Acked, flow, flow->id));
+    if (flow->socket->Connect (InetSocketAddress (receiver, m_port)) < 0)
+      {
+        Abandon (flow);
+        return;
+      }
+    m_started++;
+    // Data queued before the handshake completes is sent right after it
+    SendMore (flow, flow->id, flow->socket, flow->socket->GetTxAvailable ());
+  }
+
+  // Hand the socket as much of the flow as its buffer takes
+  static void SendMore (Flow *flow, uint64_t id, Ptr<Socket> socket, uint32_t available)
+  {
+    if (flow->id != id || flow->socket != socket)
+      {
+        return;
+      }
+    while (flow->queued < flow->size && socket->GetTxAvailable () > 0)
+      {
+        uint32_t chunk = std::min (flow->size - flow->queued, socket->GetTxAvailable ());
+        int sent = socket->Send (Create<Packet> (chunk));
+        if (sent <= 0)
+          {
+            return;
+          }
+        flow->queued += sent;
+      }
+  }
+
+  // The SYN takes sequence number 0, so byte n of the flow is
+  // acknowledged by ack n + 1
+  static void Acked (Flow *flow, uint64_t id, SequenceNumber32 oldAck, SequenceNumber32 newAck)
+  {
+    if (flow->id != id || !flow->socket || newAck.GetValue () < flow->size + 1)
+      {
+        return;
+      }
+    double fct = (Simulator::Now () - flow->start).GetSeconds ();
+    flow->workload->m_fct.Add (fct);
+    if (flow->workload->m_recorder)
+      {
+        flow->workload->m_recorder->Record (flow->size, fct);
+      }
+    flow->socket->Close ();
+    flow->workload->Release (flow);
+  }
+
+  // The handshake failed, or the connection was aborted before the flow
+  // completed
+  static void Failed (Flow *flow, uint64_t id, Ptr<Socket> socket)
+  {
+    if (flow->id == id && flow->socket == socket)
+      {
+        flow->workload->m_failed++;
+        flow->workload->Release (flow);
+      }
+  }
+
+  // A flow that could not be opened, for instance for lack of ephemeral
+  // ports, counts as rejected
+  void Abandon (Flow *flow)
+  {
+    // Released first, so that the close callbacks ignore the socket
+    Ptr<Socket> socket = flow->socket;
+    m_rejected++;
+    Release (flow);
+    socket->Close ();
+  }
+
+  void Release (Flow *flow)
+  {
+    flow->socket = 0;
+    m_active--;
+    m_free.push_back (flow);
+  }
+
+  // Sockets of the senders and receivers, listening ones included, once
+  // a second until the workload stops
+  void CountSockets (void)
+  {
+    uint32_t sockets = 0;
+    for (uint32_t i = 0; i < m_senders.size () + m_listeners.size (); i++)
+      {
+        Ptr<Node> node = i < m_senders.size () ? m_senders[i] : m_listeners[i - m_senders.size ()]->GetNode ();
+        ObjectVectorValue list;
+        node->GetObject<TcpL4Protocol> ()->GetAttribute ("SocketList", list);
+        sockets += list.GetN ();
+      }
+    m_peakSockets = std::max (m_peakSockets, sockets);
+    if (Simulator::Now () < m_stop)
+      {
+        Simulator::Schedule (Seconds (1), &FlowWorkload::CountSockets, Ptr<FlowWorkload> (this));
+      }
+  }
+
+  // Receivers only read, and close once the sender has closed
+  static void Accepted (Ptr<Socket> socket, const Address &from)
+  {
+    socket->SetRecvCallback (MakeCallback (&FlowWorkload::Drain));
+    socket->SetCloseCallbacks (MakeCallback (&FlowWorkload::PeerClosed),
+                               MakeNullCallback<void, Ptr<Socket> > ());
+  }
+
+  static void Drain (Ptr<Socket> socket)
+  {
+    while (socket->Recv ())
+      {
+      }
+  }
+
+  static void PeerClosed (Ptr<Socket> socket)
+  {
+    socket->ShutdownSend ();
+  }
+
+  Ptr<RandomVariableStream> m_arrivals;
+  double m_scale;                   //!< Pareto minimum
+  double m_shape;
+  double m_maxSize;
+  uint16_t m_port;
+  uint32_t m_maxActive;
+  Ptr<UniformRandomVariable> m_uniform;
+  std::vector<Ptr<Node> > m_senders;
+  std::vector<Ipv4Address> m_receivers;
+  std::vector<Ptr<Socket> > m_listeners;
+  std::deque<Flow> m_flows;         //!< slots; a deque keeps their addresses
+  std::vector<Flow *> m_free;
+  Time m_stop;
+  uint64_t m_nextId;
+  uint64_t m_started;
+  uint64_t m_rejected;
+  uint64_t m_failed;
+  uint32_t m_active;
+  uint32_t m_peakActive;
+  uint32_t m_peakSockets;
+  QuantileSketch m_fct;
+  Ptr<TraceRecorder> m_recorder;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_WORKLOAD_H */
@@ -0,0 +1,148 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef LIVE_METRICS_PUBLISHER_H
+#define LIVE_METRICS_PUBLISHER_H
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/callback.h"
+#include "ns3/abort.h"
+#include "live-metrics.h"
+#include "run-stats.h"
+
+namespace ns3 {
+
+/**
+ * Publish the progress of a run to a live-metrics segment.
+ *
+ * Every interval of simulated time, one event polls the counters and
+ * writes simulated time, wall time, events processed, the queue length
+ * and the bytes received per flow.  Nothing is done per packet.  The
+ * segment is called <prefix>.<pid>.<run>, where run counts the
+ * publishers of the process, so every run of a batch has its own even
+ * when one process runs several in turn.  When the simulator is destroyed the segment is marked finished
+ * and left in place, so that a reader polling it sees the final state;
+ * live-metrics-reader removes it once it has shown it.
+ */
+class LiveMetricsPublisher : public SimpleRefCount<LiveMetricsPublisher>
+{
+public:
+  /// Returns the bytes a flow has received so far
+  typedef Callback<uint64_t> Counter;
+  /// Returns the current queue length in packets
+  typedef Callback<uint32_t> Gauge;
+
+  /**
+   * \param prefix segment name prefix
+   * \param label short description of the run shown by the reader
+   * \param interval simulated time between updates
+   */
+  LiveMetricsPublisher (std::string prefix, std::string label, Time interval)
+    : m_prefix (prefix),
+      m_interval (interval)
+  {
+    Open (label);
+    Simulator::ScheduleNow (&LiveMetricsPublisher::Update, Ptr<LiveMetricsPublisher> (this));
+    Simulator::ScheduleDestroy (&LiveMetricsPublisher::Close, Ptr<LiveMetricsPublisher> (this));
+  }
+
+  void SetQueue (Gauge queue)
+  {
+    m_queue = queue;
+  }
+
+  /// Add a flow; flows beyond LiveMetricsBlock::MAX_FLOWS are not shown
+  void AddFlow (Counter counter)
+  {
+    if (m_flows.size () < LiveMetricsBlock::MAX_FLOWS)
+      {
+        m_flows.push_back (counter);
+      }
+  }
+
+  /**
+   * Move to a new segment <prefix>.<pid>.<run> under a new label, in a
+   * process forked from the one that created the publisher; the old
+   * segment is left to that process.
+   */
+  void Reopen (std::string label)
+  {
+    LiveMetricsClose (m_block);
+    Open (label);
+  }
+
+private:
+  void Open (std::string label)
+  {
+    static uint32_t runs = 0;
+    std::ostringstream oss;
+    oss << m_prefix << "." << getpid () << "." << runs++;
+    m_name = oss.str ();
+    m_block = LiveMetricsCreate (m_name);
+    NS_ABORT_MSG_UNLESS (m_block, "Cannot create " << LiveMetricsPath (m_name));
+    std::strncpy (m_block->label, label.c_str (), sizeof (m_block->label) - 1);
+  }
+
+  void Update (void)
+  {
+    LiveMetricsBeginUpdate (m_block);
+    m_block->flows = m_flows.size ();
+    m_block->simSeconds = Simulator::Now ().GetSeconds ();
+    m_block->wallSeconds = m_runStats.GetWallSeconds ();
+    m_block->events = Simulator::GetEventCount ();
+    m_block->queuePackets = m_queue.IsNull () ? 0 : m_queue ();
+    for (uint32_t i = 0; i < m_flows.size (); i++)
+      {
+        m_block->flowBytes[i] = m_flows[i] ();
+      }
+    LiveMetricsEndUpdate (m_block);
+    m_event = Simulator::Schedule (m_interval, &LiveMetricsPublisher::Update, Ptr<LiveMetricsPublisher> (this));
+  }
+
+  // Runs after the nodes are disposed, so the counters are not polled
+  void Close (void)
+  {
+    m_event.Cancel ();
+    LiveMetricsBeginUpdate (m_block);
+    m_block->finished = 1;
+    LiveMetricsEndUpdate (m_block);
+    LiveMetricsClose (m_block);
+  }
+
+  std::string m_prefix;
+  Time m_interval;
+  std::string m_name;
+  LiveMetricsBlock *m_block;
+  RunStats m_runStats;
+  Gauge m_queue;
+  std::vector<Counter> m_flows;
+  EventId m_event;
+};
+
+} // namespace ns3
+
+#endif /* LIVE_METRICS_PUBLISHER_H */
@@ -0,0 +1,181 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+// Show the live metrics of running simulations.
+//
+//   live-metrics-reader <prefix> [interval in seconds]
+//
+// Every interval, prints one line per segment /dev/shm/<prefix>.<pid>.<run>:
+// simulated time, wall time, events per second and simulated seconds
+// per wall second between its last two updates, queue length, and the
+// throughput of each flow in Mbps.  A run that has not published an
+// update for ten intervals, or that stays in the middle of an update, is
+// marked STALLED.  Segments are removed once they have been shown
+// finished, or when their process no longer exists (it was killed before
+// it could finish).  The reader does not need ns-3; it can be built with
+//   g++ -std=c++11 -o live-metrics-reader live-metrics-reader.cc
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include "live-metrics.h"
+
+// Segments whose name starts with prefix followed by a dot
+static std::vector<std::string>
+FindSegments (const std::string &prefix)
+{
+  std::vector<std::string> names;
+  DIR *dir = opendir ("/dev/shm");
+  if (!dir)
+    {
+      return names;
+    }
+  struct dirent *entry;
+  while ((entry = readdir (dir)) != 0)
+    {
+      std::string name = entry->d_name;
+      if (name.compare (0, prefix.size () + 1, prefix + ".") == 0)
+        {
+          names.push_back (name);
+        }
+    }
+  closedir (dir);
+  return names;
+}
+
+// Remove a segment and what was remembered of it.  Every run has its
+// own segment, so a finished or orphaned one is never written again.
+static void
+Forget (const std::string &name, std::map<std::string, LiveMetricsSnapshot> &last,
+        std::map<std::string, LiveMetricsSnapshot> &before, std::map<std::string, double> &lastChange)
+{
+  unlink (LiveMetricsPath (name).c_str ());
+  last.erase (name);
+  before.erase (name);
+  lastChange.erase (name);
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::fprintf (stderr, "usage: %s <prefix> [interval in seconds]\n", argv[0]);
+      return 1;
+    }
+  std::string prefix = argv[1];
+  double interval = argc > 2 ? std::atof (argv[2]) : 1.0;
+  if (interval <= 0)
+    {
+      interval = 1.0;
+    }
+
+  // Last two distinct states of every segment, and when the last one
+  // was first seen
+  std::map<std::string, LiveMetricsSnapshot> last;
+  std::map<std::string, LiveMetricsSnapshot> before;
+  std::map<std::string, double> lastChange;
+  double clock = 0;
+  while (true)
+    {
+      std::vector<std::string> names = FindSegments (prefix);
+      if (names.empty ())
+        {
+          std::printf ("no segments %s.* in /dev/shm\n", prefix.c_str ());
+        }
+      for (size_t i = 0; i < names.size (); i++)
+        {
+          const LiveMetricsBlock *block = LiveMetricsOpen (names[i]);
+          if (!block)
+            {
+              continue;
+            }
+          LiveMetricsSnapshot now;
+          bool readable = LiveMetricsRead (block, now);
+          LiveMetricsClose (block);
+          if (!readable)
+            {
+              // The writer stopped in the middle of an update
+              std::printf ("%-8lld %-24s STALLED in an update", static_cast<long long> (now.pid),
+                           last.count (names[i]) ? last[names[i]].label.c_str () : names[i].c_str ());
+              if (kill (static_cast<pid_t> (now.pid), 0) < 0 && errno == ESRCH)
+                {
+                  std::printf ("  exited\n");
+                  Forget (names[i], last, before, lastChange);
+                  continue;
+                }
+              std::printf ("\n");
+              continue;
+            }
+          if (!last.count (names[i]) || last[names[i]].wallSeconds != now.wallSeconds)
+            {
+              if (last.count (names[i]))
+                {
+                  before[names[i]] = last[names[i]];
+                }
+              last[names[i]] = now;
+              lastChange[names[i]] = clock;
+            }
+
+          std::printf ("%-8lld %-24s sim %9.3f s  wall %8.1f s", static_cast<long long> (now.pid),
+                       now.label.c_str (), now.simSeconds, now.wallSeconds);
+          std::printf ("  queue %5.0f", now.queuePackets);
+          std::map<std::string, LiveMetricsSnapshot>::const_iterator it = before.find (names[i]);
+          if (it != before.end ())
+            {
+              const LiveMetricsSnapshot &prev = it->second;
+              double wall = now.wallSeconds - prev.wallSeconds;
+              double sim = now.simSeconds - prev.simSeconds;
+              std::printf ("  %10.0f ev/s  %7.3f sim/wall", (now.events - prev.events) / wall, sim / wall);
+              for (uint32_t f = 0; f < now.flows && sim > 0; f++)
+                {
+                  std::printf ("  %7.3f", (now.flowBytes[f] - prev.flowBytes[f]) * 8 / sim / 1e6);
+                }
+            }
+          if (now.finished)
+            {
+              std::printf ("  finished\n");
+              Forget (names[i], last, before, lastChange);
+              continue;
+            }
+          if (kill (static_cast<pid_t> (now.pid), 0) < 0 && errno == ESRCH)
+            {
+              std::printf ("  exited\n");
+              Forget (names[i], last, before, lastChange);
+              continue;
+            }
+          if (clock - lastChange[names[i]] >= 10 * interval)
+            {
+              std::printf ("  STALLED %.0f s", clock - lastChange[names[i]]);
+            }
+          std::printf ("\n");
+        }
+      std::fflush (stdout);
+      clock += interval;
+      usleep (static_cast<useconds_t> (interval * 1e6));
+    }
+}
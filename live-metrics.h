@@ -0,0 +1,217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef LIVE_METRICS_H
+#define LIVE_METRICS_H
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Layout of the live-metrics segment shared between a running simulation
+ * and live-metrics-reader.  It does not depend on ns-3, so the reader
+ * builds without it.
+ *
+ * A segment is the file /dev/shm/<name>.  The simulation is the only
+ * writer; it brackets every update with two increments of seq, so seq is
+ * odd while an update is in progress, and readers retry until they copy
+ * the block with the same even seq before and after (a seqlock).  The
+ * writer never waits; a reader gives up after about 0.1 s, as a writer
+ * that was killed or stopped in the middle of an update leaves seq odd
+ * for good.
+ */
+struct LiveMetricsBlock
+{
+  static const uint32_t MAX_FLOWS = 64;
+
+  char magic[8];                  //!< "NSLIVE1"
+  std::atomic<uint64_t> seq;
+  int64_t pid;
+  char label[64];                 //!< program and configuration
+  uint32_t finished;              //!< set once the run has ended
+  uint32_t flows;                 //!< entries of flowBytes in use
+  double simSeconds;              //!< simulated time
+  double wallSeconds;             //!< wall-clock time since the start of the run
+  uint64_t events;                //!< events processed
+  double queuePackets;            //!< bottleneck queue length
+  uint64_t flowBytes[MAX_FLOWS];  //!< bytes received per flow
+};
+
+/// Plain copy of a LiveMetricsBlock
+struct LiveMetricsSnapshot
+{
+  int64_t pid;
+  std::string label;
+  bool finished;
+  uint32_t flows;
+  double simSeconds;
+  double wallSeconds;
+  uint64_t events;
+  double queuePackets;
+  uint64_t flowBytes[LiveMetricsBlock::MAX_FLOWS];
+};
+
+/// Path of the segment called name
+inline std::string
+LiveMetricsPath (const std::string &name)
+{
+  return "/dev/shm/" + name;
+}
+
+/**
+ * Create the segment called name and map it read-write.
+ *
+ * A segment is never truncated once it exists, as that would fault
+ * readers that have it mapped; a leftover file of the same name is
+ * unlinked instead, and readers keep their mapping of it.
+ *
+ * \return the block, or 0 on failure
+ */
+inline LiveMetricsBlock *
+LiveMetricsCreate (const std::string &name)
+{
+  std::string path = LiveMetricsPath (name);
+  unlink (path.c_str ());
+  int fd = open (path.c_str (), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+    {
+      return 0;
+    }
+  if (ftruncate (fd, sizeof (LiveMetricsBlock)) != 0)
+    {
+      close (fd);
+      return 0;
+    }
+  void *base = mmap (0, sizeof (LiveMetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED)
+    {
+      return 0;
+    }
+  // The file is zero-filled, which is a valid initial state
+  LiveMetricsBlock *block = static_cast<LiveMetricsBlock *> (base);
+  block->pid = getpid ();
+  std::memcpy (block->magic, "NSLIVE1", 8);
+  return block;
+}
+
+/**
+ * Map the segment called name read-only.
+ *
+ * \return the block, or 0 if there is no such segment
+ */
+inline const LiveMetricsBlock *
+LiveMetricsOpen (const std::string &name)
+{
+  std::string path = LiveMetricsPath (name);
+  int fd = open (path.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      return 0;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size < static_cast<off_t> (sizeof (LiveMetricsBlock)))
+    {
+      close (fd);
+      return 0;
+    }
+  void *base = mmap (0, sizeof (LiveMetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED)
+    {
+      return 0;
+    }
+  const LiveMetricsBlock *block = static_cast<const LiveMetricsBlock *> (base);
+  if (std::memcmp (block->magic, "NSLIVE1", 8) != 0)
+    {
+      munmap (base, sizeof (LiveMetricsBlock));
+      return 0;
+    }
+  return block;
+}
+
+/// Unmap a block returned by LiveMetricsCreate () or LiveMetricsOpen ()
+inline void
+LiveMetricsClose (const LiveMetricsBlock *block)
+{
+  munmap (const_cast<LiveMetricsBlock *> (block), sizeof (LiveMetricsBlock));
+}
+
+/// Writer side: open an update of the block
+inline void
+LiveMetricsBeginUpdate (LiveMetricsBlock *block)
+{
+  block->seq.fetch_add (1, std::memory_order_relaxed);
+  std::atomic_thread_fence (std::memory_order_release);
+}
+
+/// Writer side: publish the update
+inline void
+LiveMetricsEndUpdate (LiveMetricsBlock *block)
+{
+  block->seq.fetch_add (1, std::memory_order_release);
+}
+
+/**
+ * Reader side: copy a consistent state of the block to s.
+ *
+ * \return false if every attempt met an update in progress; only s.pid,
+ *         which is written once when the segment is created, is set then
+ */
+inline bool
+LiveMetricsRead (const LiveMetricsBlock *block, LiveMetricsSnapshot &s)
+{
+  s.pid = block->pid;
+  for (uint32_t attempt = 0; attempt < 100; attempt++)
+    {
+      if (attempt > 0)
+        {
+          usleep (1000);
+        }
+      uint64_t before = block->seq.load (std::memory_order_acquire);
+      if (before & 1)
+        {
+          continue;
+        }
+      s.label.assign (block->label, strnlen (block->label, sizeof (block->label)));
+      s.finished = block->finished != 0;
+      s.flows = block->flows < LiveMetricsBlock::MAX_FLOWS ? block->flows : LiveMetricsBlock::MAX_FLOWS;
+      s.simSeconds = block->simSeconds;
+      s.wallSeconds = block->wallSeconds;
+      s.events = block->events;
+      s.queuePackets = block->queuePackets;
+      std::memcpy (s.flowBytes, block->flowBytes, sizeof (s.flowBytes));
+      std::atomic_thread_fence (std::memory_order_acquire);
+      if (block->seq.load (std::memory_order_relaxed) == before)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+#endif /* LIVE_METRICS_H */
@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef MY_APP_H
+#define MY_APP_H
+
+#include <vector>
+#include "ns3/application.h"
+#include "ns3/socket.h"
+#include "ns3/address.h"
+#include "ns3/data-rate.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+/**
+ * TCP source sending nPackets packets of packetSize bytes at dataRate,
+ * shared by tcp-performance and tcp-performance2.
+ */
+class MyApp : public Application
+{
+public:
+  MyApp ()
+    : m_socket (0),
+      m_peer (),
+      m_packetSize (0),
+      m_nPackets (0),
+      m_dataRate (0),
+      m_sendEvent (),
+      m_running (false),
+      m_packetsSent (0),
+      m_blocked (false),
+      m_usePool (false),
+      m_poolSize (0),
+      m_poolCursor (0),
+      m_packetsAllocated (0),
+      m_poolHits (0),
+      m_maxBurst (1),
+      m_pacingRemainder (0)
+  {
+  }
+
+  virtual ~MyApp ()
+  {
+    m_socket = 0;
+    m_pool.clear ();
+  }
+
+  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
+  {
+    m_socket = socket;
+    m_peer = address;
+    m_packetSize = packetSize;
+    m_nPackets = nPackets;
+    m_dataRate = dataRate;
+  }
+
+  /// Reuse sent packets once the socket has released them
+  void SetPacketPool (bool enable, uint32_t poolSize = 256)
+  {
+    m_usePool = enable;
+    m_poolSize = poolSize;
+  }
+
+  /// Send up to maxBurst packets per timer event, keeping the same rate
+  void SetBurst (uint32_t maxBurst)
+  {
+    m_maxBurst = maxBurst > 0 ? maxBurst : 1;
+  }
+
+  uint32_t GetPacketsSent (void) const
+  {
+    return m_packetsSent;
+  }
+
+  /// Packets made with Create<Packet>
+  uint32_t GetPacketsAllocated (void) const
+  {
+    return m_packetsAllocated;
+  }
+
+  /// Packets handed out again from the pool
+  uint32_t GetPoolHits (void) const
+  {
+    return m_poolHits;
+  }
+
+private:
+  virtual void StartApplication (void)
+  {
+    m_running = true;
+    m_packetsSent = 0;
+    m_blocked = false;
+    m_pacingRemainder = 0;
+    m_socket->Bind ();
+    m_socket->Connect (m_peer);
+    m_socket->SetSendCallback (MakeCallback (&MyApp::SpaceAvailable, this));
+    SendPacket ();
+  }
+
+  virtual void StopApplication (void)
+  {
+    m_running = false;
+
+    if (m_sendEvent.IsRunning ())
+      {
+        Simulator::Cancel (m_sendEvent);
+      }
+
+    if (m_socket)
+      {
+        m_socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+        m_socket->Close ();
+      }
+  }
+
+  void SendPacket (void)
+  {
+    uint32_t burst = 0;
+    while (burst < m_maxBurst && m_packetsSent < m_nPackets)
+      {
+        // Do not offer a segment the send buffer cannot take; SpaceAvailable ()
+        // resumes sending once TCP has freed enough space
+        if (m_socket->GetTxAvailable () < m_packetSize)
+          {
+            m_blocked = true;
+            return;
+          }
+
+        Ptr<Packet> packet = GetPacket ();
+        if (m_socket->Send (packet) < 0)
+          {
+            m_blocked = true;
+            return;
+          }
+        m_packetsSent++;
+        burst++;
+      }
+
+    if (m_packetsSent < m_nPackets)
+      {
+        ScheduleTx (burst);
+      }
+  }
+
+  // The next burst leaves once the packets just sent have had their time
+  // at m_dataRate.  Intervals are counted in time steps, and the remainder
+  // of each division is carried over, so the long-run rate is exact.
+  void ScheduleTx (uint32_t packets)
+  {
+    if (m_running)
+      {
+        uint64_t bitRate = m_dataRate.GetBitRate ();
+        uint64_t stepsPerPacket = static_cast<uint64_t> (m_packetSize) * 8 * Seconds (1).GetTimeStep ();
+        uint64_t steps = 0;
+        for (uint32_t i = 0; i < packets; i++)
+          {
+            m_pacingRemainder += stepsPerPacket;
+            steps += m_pacingRemainder / bitRate;
+            m_pacingRemainder %= bitRate;
+          }
+        m_sendEvent = Simulator::Schedule (TimeStep (steps), &MyApp::SendPacket, this);
+      }
+  }
+
+  void SpaceAvailable (Ptr<Socket> socket, uint32_t available)
+  {
+    if (m_running && m_blocked && available >= m_packetSize)
+      {
+        m_blocked = false;
+        SendPacket ();
+      }
+  }
+
+  // The payload is never inspected, so every packet carries a zero-filled
+  // virtual payload of m_packetSize bytes.  With the pool enabled, a packet
+  // is handed out again once its reference count shows that the socket
+  // has released it, which saves the Packet object and its Buffer of a
+  // Create<Packet>.  The send buffer splits and merges the packets it
+  // holds in place whenever the write size is not a multiple of the
+  // segment size, so a released packet is first trimmed or padded back
+  // to m_packetSize; padding may still allocate buffer space.  Compare
+  // the process-wide allocations of runs with and without the pool.
+  Ptr<Packet> GetPacket (void)
+  {
+    for (uint32_t i = 0; m_usePool && i < m_pool.size (); i++)
+      {
+        uint32_t slot = m_poolCursor;
+        m_poolCursor = (m_poolCursor + 1) % m_pool.size ();
+        // Only the pool holds a reference once the socket is done with it
+        Ptr<Packet> &packet = m_pool[slot];
+        if (packet->GetReferenceCount () > 1)
+          {
+            continue;
+          }
+        if (packet->GetSize () > m_packetSize)
+          {
+            packet->RemoveAtEnd (packet->GetSize () - m_packetSize);
+          }
+        else if (packet->GetSize () < m_packetSize)
+          {
+            packet->AddPaddingAtEnd (m_packetSize - packet->GetSize ());
+          }
+        packet->RemoveAllPacketTags ();
+        packet->RemoveAllByteTags ();
+        m_poolHits++;
+        return packet;
+      }
+
+    Ptr<Packet> packet = Create<Packet> (m_packetSize);
+    m_packetsAllocated++;
+    if (m_usePool && m_pool.size () < m_poolSize)
+      {
+        m_pool.push_back (packet);
+      }
+    return packet;
+  }
+
+  Ptr<Socket>     m_socket;
+  Address         m_peer;
+  uint32_t        m_packetSize;
+  uint32_t        m_nPackets;
+  DataRate        m_dataRate;
+  EventId         m_sendEvent;
+  bool            m_running;
+  uint32_t        m_packetsSent;
+  bool            m_blocked;
+  bool            m_usePool;
+  uint32_t        m_poolSize;
+  uint32_t        m_poolCursor;
+  std::vector<Ptr<Packet> > m_pool;
+  uint32_t        m_packetsAllocated;
+  uint32_t        m_poolHits;
+  uint32_t        m_maxBurst;
+  uint64_t        m_pacingRemainder;
+};
+
+} // namespace ns3
+
+#endif /* MY_APP_H */
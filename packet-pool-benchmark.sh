@@ -0,0 +1,19 @@
+#!/bin/sh
+#
+# Compare heap allocations with and without the MyApp packet pool.
+#
+# Run from the top of an ns-3 tree whose scratch/ directory holds these
+# examples.  Each run prints packets sent, packets created and reused by
+# MyApp, operator new calls of the whole process (allocation-counter.h)
+# and their rate per wall-clock second, and peak RSS.  The pool hit rate
+# is poolHits / packets.
+
+WAF=${WAF:-./waf}
+
+for pool in 0 1
+do
+  echo "== tcp-performance2, packetPool=$pool"
+  $WAF --run "scratch/tcp-performance2 --printStats --packetPool=$pool" || exit 1
+  echo "== tcp-performance, packetPool=$pool"
+  $WAF --run "scratch/tcp-performance --printStats --packetPool=$pool --jobs=0" || exit 1
+done
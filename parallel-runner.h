@@ -0,0 +1,195 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef PARALLEL_RUNNER_H
+#define PARALLEL_RUNNER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "ns3/callback.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * Run independent simulation jobs in forked worker processes.
+ *
+ * Every job runs in its own child process, so each one starts from a
+ * fresh simulator and ends with its own Simulator::Destroy ().  A job
+ * returns its result as text, which the child writes to a pipe; the
+ * parent collects the results and returns them in job order, no matter
+ * in which order the workers finish.
+ */
+class ParallelRunner
+{
+public:
+  /// A job maps a job index to its result text
+  typedef Callback<std::string, uint32_t> Job;
+
+  /**
+   * \param maxWorkers maximum number of concurrent worker processes;
+   *        0 uses one worker per online core
+   */
+  ParallelRunner (uint32_t maxWorkers)
+    : m_maxWorkers (maxWorkers)
+  {
+    if (m_maxWorkers == 0)
+      {
+        long cores = sysconf (_SC_NPROCESSORS_ONLN);
+        m_maxWorkers = cores > 0 ? static_cast<uint32_t> (cores) : 1;
+      }
+  }
+
+  uint32_t GetMaxWorkers (void) const
+  {
+    return m_maxWorkers;
+  }
+
+  /**
+   * Run jobs 0 .. nJobs - 1 and return their results in job order.
+   */
+  std::vector<std::string> Run (uint32_t nJobs, Job job)
+  {
+    std::vector<std::string> results (nJobs);
+    std::map<int, Worker> workers;          // keyed by pipe read end
+    uint32_t next = 0;
+
+    while (next < nJobs || !workers.empty ())
+      {
+        while (next < nJobs && workers.size () < m_maxWorkers)
+          {
+            Worker w = Spawn (next, job);
+            workers[w.fd] = w;
+            next++;
+          }
+
+        std::vector<struct pollfd> fds;
+        for (std::map<int, Worker>::const_iterator it = workers.begin (); it != workers.end (); ++it)
+          {
+            struct pollfd p;
+            p.fd = it->first;
+            p.events = POLLIN;
+            p.revents = 0;
+            fds.push_back (p);
+          }
+        if (poll (&fds[0], fds.size (), -1) < 0)
+          {
+            NS_ABORT_MSG_IF (errno != EINTR, "poll failed: " << std::strerror (errno));
+            continue;
+          }
+
+        for (size_t i = 0; i < fds.size (); i++)
+          {
+            if (fds[i].revents == 0)
+              {
+                continue;
+              }
+            Worker &w = workers[fds[i].fd];
+            char buf[4096];
+            ssize_t n = read (w.fd, buf, sizeof (buf));
+            if (n > 0)
+              {
+                results[w.index].append (buf, n);
+                continue;
+              }
+            if (n < 0 && errno == EINTR)
+              {
+                continue;
+              }
+            // End of file: the worker has finished
+            close (w.fd);
+            int status = 0;
+            waitpid (w.pid, &status, 0);
+            NS_ABORT_MSG_UNLESS (WIFEXITED (status) && WEXITSTATUS (status) == 0,
+                                 "Worker for job " << w.index << " failed");
+            workers.erase (fds[i].fd);
+          }
+      }
+    return results;
+  }
+
+private:
+  struct Worker
+  {
+    pid_t pid;
+    int fd;
+    uint32_t index;
+  };
+
+  Worker Spawn (uint32_t index, Job job)
+  {
+    int fds[2];
+    NS_ABORT_MSG_IF (pipe (fds) != 0, "pipe failed: " << std::strerror (errno));
+
+    // Do not let buffered output be written twice by parent and child
+    std::cout.flush ();
+    std::cerr.flush ();
+
+    pid_t pid = fork ();
+    NS_ABORT_MSG_IF (pid < 0, "fork failed: " << std::strerror (errno));
+    if (pid == 0)
+      {
+        close (fds[0]);
+        std::string result = job (index);
+        const char *p = result.data ();
+        size_t left = result.size ();
+        while (left > 0)
+          {
+            ssize_t n = write (fds[1], p, left);
+            if (n < 0 && errno == EINTR)
+              {
+                continue;
+              }
+            if (n <= 0)
+              {
+                _exit (1);
+              }
+            p += n;
+            left -= n;
+          }
+        close (fds[1]);
+        std::cout.flush ();
+        std::cerr.flush ();
+        _exit (0);
+      }
+
+    close (fds[1]);
+    Worker w;
+    w.pid = pid;
+    w.fd = fds[0];
+    w.index = index;
+    return w;
+  }
+
+  uint32_t m_maxWorkers;
+};
+
+} // namespace ns3
+
+#endif /* PARALLEL_RUNNER_H */
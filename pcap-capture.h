@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef PCAP_CAPTURE_H
+#define PCAP_CAPTURE_H
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/callback.h"
+#include "ns3/trace-helper.h"
+
+namespace ns3 {
+
+/**
+ * Header-level pcap capture of one point-to-point device.
+ *
+ * Unlike PointToPointHelper::EnablePcap, the capture
+ *  - keeps only the first SnapLen bytes of each packet,
+ *  - is connected to the device only between start and stop, and
+ *  - starts a new file once the current one would exceed maxFileBytes.
+ *
+ * Files are named <prefix>-<node>-<device>.pcap, and rotated files get a
+ * -<n> suffix before the extension.
+ */
+class PcapCapture : public SimpleRefCount<PcapCapture>
+{
+public:
+  /**
+   * \param prefix file name prefix
+   * \param device point-to-point device to capture on
+   * \param snapLen bytes kept per packet; 0 keeps whole packets
+   * \param start time at which capture starts
+   * \param stop time at which capture stops
+   * \param maxFileBytes size cap of one file; 0 never rotates
+   */
+  PcapCapture (std::string prefix, Ptr<NetDevice> device, uint32_t snapLen,
+               Time start, Time stop, uint64_t maxFileBytes)
+    : m_device (device),
+      m_snapLen (snapLen ? snapLen : std::numeric_limits<uint32_t>::max ()),
+      m_maxFileBytes (maxFileBytes),
+      m_fileBytes (0),
+      m_index (0)
+  {
+    std::ostringstream oss;
+    oss << prefix << "-" << device->GetNode ()->GetId () << "-" << device->GetIfIndex ();
+    m_name = oss.str ();
+    Simulator::Schedule (start, &PcapCapture::Connect, Ptr<PcapCapture> (this));
+    Simulator::Schedule (stop, &PcapCapture::Disconnect, Ptr<PcapCapture> (this));
+  }
+
+private:
+  // Size of the pcap global header and of a record header
+  static const uint32_t FILE_HEADER = 24;
+  static const uint32_t RECORD_HEADER = 16;
+
+  void Connect (void)
+  {
+    Open ();
+    m_device->TraceConnectWithoutContext ("PromiscSniffer", MakeCallback (&PcapCapture::Sniff, this));
+  }
+
+  void Disconnect (void)
+  {
+    m_device->TraceDisconnectWithoutContext ("PromiscSniffer", MakeCallback (&PcapCapture::Sniff, this));
+    m_file = 0;
+  }
+
+  void Open (void)
+  {
+    std::ostringstream oss;
+    oss << m_name;
+    if (m_index > 0)
+      {
+        oss << "-" << m_index;
+      }
+    oss << ".pcap";
+    m_index++;
+
+    PcapHelper pcapHelper;
+    m_file = pcapHelper.CreateFile (oss.str (), std::ios::out, PcapHelper::DLT_PPP, m_snapLen);
+    m_fileBytes = FILE_HEADER;
+  }
+
+  void Sniff (Ptr<const Packet> packet)
+  {
+    uint64_t record = RECORD_HEADER + std::min (packet->GetSize (), m_snapLen);
+    if (m_maxFileBytes > 0 && m_fileBytes > FILE_HEADER && m_fileBytes + record > m_maxFileBytes)
+      {
+        Open ();
+      }
+    m_file->Write (Simulator::Now (), packet);
+    m_fileBytes += record;
+  }
+
+  Ptr<NetDevice> m_device;
+  uint32_t m_snapLen;
+  uint64_t m_maxFileBytes;
+  uint64_t m_fileBytes;
+  uint32_t m_index;
+  std::string m_name;
+  Ptr<PcapFileWrapper> m_file;
+};
+
+} // namespace ns3
+
+#endif /* PCAP_CAPTURE_H */
@@ -0,0 +1,311 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef PROFILING_SCHEDULER_H
+#define PROFILING_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include <cxxabi.h>
+#include "ns3/scheduler.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/type-id.h"
+#include "ns3/nstime.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * Event scheduler that profiles the events it hands out.
+ *
+ * The simulator removes an event from the scheduler right before it
+ * runs it, so the wall-clock time between two RemoveNext () calls is
+ * the cost of the first event, including the events it schedules.  The
+ * profiler charges that time and one event to the dynamic type of the
+ * event, which for MakeEvent () and Simulator::Schedule () names the
+ * function or member function pointer type and its bound arguments.
+ * Every SampleInterval wall-clock seconds it also records the simulated
+ * time reached.  The real scheduler is InnerType.
+ *
+ * When the simulator is destroyed, the profile is appended to
+ * <Output>.txt, sorted by wall time, and to <Output>.folded, one
+ * "simulator;<event type> <ns>" line per type as read by flame graph
+ * tools.  The time of the last event of a run is not measured.
+ */
+class ProfilingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ProfilingScheduler")
+      .SetParent<Scheduler> ()
+      .SetGroupName ("Core")
+      .AddConstructor<ProfilingScheduler> ()
+      .AddAttribute ("InnerType", "Scheduler that holds the events",
+                     TypeIdValue (MapScheduler::GetTypeId ()),
+                     MakeTypeIdAccessor (&ProfilingScheduler::m_innerType),
+                     MakeTypeIdChecker ())
+      .AddAttribute ("Output", "Prefix of the profile files",
+                     StringValue ("profile"),
+                     MakeStringAccessor (&ProfilingScheduler::m_output),
+                     MakeStringChecker ())
+      .AddAttribute ("SampleInterval", "Wall-clock seconds between samples of the simulated time",
+                     DoubleValue (1.0),
+                     MakeDoubleAccessor (&ProfilingScheduler::m_sampleInterval),
+                     MakeDoubleChecker<double> (0))
+    ;
+    return tid;
+  }
+
+  ProfilingScheduler ()
+    : m_current (0),
+      m_events (0),
+      m_lastSample (0),
+      m_finished (false)
+  {
+  }
+
+  virtual void Insert (const Event &ev)
+  {
+    if (!m_inner)
+      {
+        ObjectFactory factory;
+        factory.SetTypeId (m_innerType);
+        m_inner = factory.Create<Scheduler> ();
+        m_start = Clock::now ();
+        m_eventStart = m_start;
+        // Write the profile before the simulator drains the events left
+        Simulator::ScheduleDestroy (&ProfilingScheduler::Finish, Ptr<ProfilingScheduler> (this));
+      }
+    m_inner->Insert (ev);
+  }
+
+  virtual bool IsEmpty (void) const
+  {
+    return !m_inner || m_inner->IsEmpty ();
+  }
+
+  virtual Event PeekNext (void) const
+  {
+    return m_inner->PeekNext ();
+  }
+
+  virtual Event RemoveNext (void)
+  {
+    Event ev = m_inner->RemoveNext ();
+    if (m_finished)
+      {
+        return ev;
+      }
+    Clock::time_point now = Clock::now ();
+    Charge (now);
+    m_current = &typeid (*ev.impl);
+    m_eventStart = now;
+    m_events++;
+
+    double wall = WallSeconds (now);
+    if (wall - m_lastSample >= m_sampleInterval)
+      {
+        m_lastSample = wall;
+        m_samples.push_back (std::make_pair (wall, TimeStep (ev.key.m_ts).GetSeconds ()));
+      }
+    return ev;
+  }
+
+  virtual void Remove (const Event &ev)
+  {
+    m_inner->Remove (ev);
+  }
+
+  /**
+   * Wrap the scheduler selected by SchedulerType in a profiler writing to
+   * <output>.txt and <output>.folded, and truncate both files.  Call
+   * once, before the first simulator is created.
+   */
+  static void Enable (std::string output)
+  {
+    TypeIdValue inner;
+    GlobalValue::GetValueByName ("SchedulerType", inner);
+    Config::SetDefault ("ns3::ProfilingScheduler::InnerType", inner);
+    Config::SetDefault ("ns3::ProfilingScheduler::Output", StringValue (output));
+    GlobalValue::Bind ("SchedulerType", TypeIdValue (ProfilingScheduler::GetTypeId ()));
+    const char *suffixes[] = { ".txt", ".folded" };
+    for (uint32_t i = 0; i < 2; i++)
+      {
+        std::string name = output + suffixes[i];
+        std::FILE *f = std::fopen (name.c_str (), "w");
+        NS_ABORT_MSG_UNLESS (f, "Cannot open " << name);
+        std::fclose (f);
+      }
+  }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Cost
+  {
+    Cost () : events (0), ns (0) {}
+    uint64_t events;
+    uint64_t ns;
+  };
+
+  double WallSeconds (Clock::time_point t) const
+  {
+    return std::chrono::duration<double> (t - m_start).count ();
+  }
+
+  void Charge (Clock::time_point now)
+  {
+    if (m_current)
+      {
+        Cost &cost = m_costs[m_current];
+        cost.events++;
+        cost.ns += std::chrono::duration_cast<std::chrono::nanoseconds> (now - m_eventStart).count ();
+      }
+  }
+
+  // Readable name of an event type: the template arguments of MakeEvent
+  // helpers, or the demangled type name, without ns3:: qualifiers
+  static std::string Name (const std::type_info *type)
+  {
+    int status;
+    char *demangled = abi::__cxa_demangle (type->name (), 0, 0, &status);
+    std::string name = status == 0 ? demangled : type->name ();
+    std::free (demangled);
+
+    std::string::size_type begin = name.find ("MakeEvent<");
+    std::string::size_type end = name.find (">(", begin);
+    if (begin != std::string::npos && end != std::string::npos)
+      {
+        name = name.substr (begin + 10, end - begin - 10);
+      }
+    std::string::size_type pos;
+    while ((pos = name.find ("ns3::")) != std::string::npos)
+      {
+        name.erase (pos, 5);
+      }
+    std::replace (name.begin (), name.end (), ';', ',');
+    return name;
+  }
+
+  void Finish (void)
+  {
+    if (m_finished)
+      {
+        return;
+      }
+    m_finished = true;
+    // The last event ran until Simulator::Run () returned; only count it
+    if (m_current)
+      {
+        m_costs[m_current].events++;
+      }
+    double wall = WallSeconds (Clock::now ());
+    double sim = Simulator::Now ().GetSeconds ();
+
+    // Types with the same name, e.g. from different libraries, are merged
+    std::map<std::string, Cost> byName;
+    uint64_t totalNs = 0;
+    for (CostMap::const_iterator it = m_costs.begin (); it != m_costs.end (); ++it)
+      {
+        Cost &cost = byName[Name (it->first)];
+        cost.events += it->second.events;
+        cost.ns += it->second.ns;
+        totalNs += it->second.ns;
+      }
+    std::vector<std::pair<uint64_t, std::string> > order;
+    for (std::map<std::string, Cost>::const_iterator it = byName.begin (); it != byName.end (); ++it)
+      {
+        order.push_back (std::make_pair (it->second.ns, it->first));
+      }
+    std::sort (order.rbegin (), order.rend ());
+
+    std::ostringstream txt;
+    txt << "# run " << RngSeedManager::GetRun () << ": events " << m_events
+        << " wall " << wall << " s sim " << sim << " s sim/wall " << (wall > 0 ? sim / wall : 0) << "\n"
+        << "# wall_s\tshare\tevents\tns/event\ttype\n";
+    std::ostringstream folded;
+    for (uint32_t i = 0; i < order.size (); i++)
+      {
+        const Cost &cost = byName[order[i].second];
+        txt << cost.ns / 1e9 << "\t" << (totalNs ? 100.0 * cost.ns / totalNs : 0) << "%\t"
+            << cost.events << "\t" << (cost.events ? cost.ns / cost.events : 0) << "\t"
+            << order[i].second << "\n";
+        folded << "simulator;" << order[i].second << " " << cost.ns << "\n";
+      }
+    txt << "# wall_s\tsim_s\tsim/wall\n";
+    for (uint32_t i = 0; i < m_samples.size (); i++)
+      {
+        txt << m_samples[i].first << "\t" << m_samples[i].second << "\t"
+            << (m_samples[i].first > 0 ? m_samples[i].second / m_samples[i].first : 0) << "\n";
+      }
+    txt << "\n";
+    Append (m_output + ".txt", txt.str ());
+    Append (m_output + ".folded", folded.str ());
+  }
+
+  // One write per report, so reports of parallel workers do not interleave
+  static void Append (std::string name, const std::string &text)
+  {
+    std::FILE *f = std::fopen (name.c_str (), "a");
+    NS_ABORT_MSG_UNLESS (f, "Cannot open " << name);
+    std::setvbuf (f, 0, _IONBF, 0);
+    std::fwrite (text.data (), 1, text.size (), f);
+    std::fclose (f);
+  }
+
+  typedef std::unordered_map<const std::type_info *, Cost> CostMap;
+
+  TypeId m_innerType;
+  std::string m_output;
+  double m_sampleInterval;
+  Ptr<Scheduler> m_inner;
+  Clock::time_point m_start;
+  Clock::time_point m_eventStart;
+  const std::type_info *m_current;   //!< type of the running event
+  uint64_t m_events;
+  CostMap m_costs;
+  double m_lastSample;
+  std::vector<std::pair<double, double> > m_samples;   //!< (wall, sim) seconds
+  bool m_finished;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ProfilingScheduler);
+
+} // namespace ns3
+
+#endif /* PROFILING_SCHEDULER_H */
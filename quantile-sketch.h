@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Quantiles of a stream of positive values, such as delays in seconds,
+ * in bounded memory.
+ *
+ * Values go into log-linear buckets as in HDR histograms: every power of
+ * two between 2^MIN_EXP (about 1 ns) and 2^MAX_EXP (about 12 days) is
+ * split into SUB_BUCKETS equal buckets, so a quantile is reported within
+ * 0.4% of a value that was added.  Only the buckets between the smallest
+ * and the largest value seen are allocated, a few hundred counters for
+ * delays spanning one or two orders of magnitude and never more than
+ * 6400.  Values at or below zero count as zero; larger values than the
+ * range count in the top bucket.
+ *
+ * Two sketches merge exactly by adding their counts, so replications
+ * run in separate worker processes combine through Serialize () and
+ * Parse () without losing accuracy.
+ */
+class QuantileSketch
+{
+public:
+  static const int MIN_EXP = -30;
+  static const int MAX_EXP = 20;
+  static const uint32_t SUB_BUCKETS = 128;
+
+  QuantileSketch ()
+    : m_count (0),
+      m_zeros (0),
+      m_min (std::numeric_limits<double>::infinity ()),
+      m_max (0),
+      m_sum (0),
+      m_offset (0)
+  {
+  }
+
+  void Add (double value)
+  {
+    m_count++;
+    m_sum += value > 0 ? value : 0;
+    m_min = std::min (m_min, value > 0 ? value : 0);
+    m_max = std::max (m_max, value);
+    if (value <= 0)
+      {
+        m_zeros++;
+        return;
+      }
+    uint32_t index = Index (value);
+    Grow (index, index);
+    m_counts[index - m_offset]++;
+  }
+
+  /// Add the values of other
+  void Merge (const QuantileSketch &other)
+  {
+    if (other.m_count == 0)
+      {
+        return;
+      }
+    m_count += other.m_count;
+    m_zeros += other.m_zeros;
+    m_sum += other.m_sum;
+    m_min = std::min (m_min, other.m_min);
+    m_max = std::max (m_max, other.m_max);
+    if (other.m_counts.empty ())
+      {
+        return;
+      }
+    Grow (other.m_offset, other.m_offset + other.m_counts.size () - 1);
+    for (uint32_t i = 0; i < other.m_counts.size (); i++)
+      {
+        m_counts[other.m_offset + i - m_offset] += other.m_counts[i];
+      }
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+
+  double GetMean (void) const
+  {
+    return m_count ? m_sum / m_count : 0;
+  }
+
+  double GetMax (void) const
+  {
+    return m_max;
+  }
+
+  /**
+   * Value below which a fraction q of the values lie (nearest rank), as
+   * the midpoint of its bucket; 0 if the sketch is empty
+   */
+  double GetQuantile (double q) const
+  {
+    if (m_count == 0)
+      {
+        return 0;
+      }
+    uint64_t rank = static_cast<uint64_t> (std::ceil (std::min (std::max (q, 0.0), 1.0) * m_count));
+    rank = std::max<uint64_t> (rank, 1);
+    if (rank <= m_zeros)
+      {
+        return 0;
+      }
+    uint64_t seen = m_zeros;
+    for (uint32_t i = 0; i < m_counts.size (); i++)
+      {
+        seen += m_counts[i];
+        if (seen >= rank)
+          {
+            double value = Midpoint (m_offset + i);
+            return std::min (std::max (value, m_min), m_max);
+          }
+      }
+    return m_max;
+  }
+
+  /// One-line text form, read back by Parse ()
+  std::string Serialize (void) const
+  {
+    std::ostringstream oss;
+    oss.precision (17);
+    oss << m_count << " " << m_zeros << " " << (m_count > m_zeros ? m_min : 0) << " " << m_max
+        << " " << m_sum << " " << m_offset << " " << m_counts.size ();
+    for (uint32_t i = 0; i < m_counts.size (); i++)
+      {
+        oss << " " << m_counts[i];
+      }
+    return oss.str ();
+  }
+
+  /// Read a sketch written by Serialize () from is
+  bool Parse (std::istream &is)
+  {
+    size_t n = 0;
+    *this = QuantileSketch ();
+    if (!(is >> m_count >> m_zeros >> m_min >> m_max >> m_sum >> m_offset >> n)
+        || m_offset + n > Buckets ())
+      {
+        return false;
+      }
+    m_counts.resize (n);
+    for (size_t i = 0; i < n; i++)
+      {
+        if (!(is >> m_counts[i]))
+          {
+            return false;
+          }
+      }
+    if (m_count == 0)
+      {
+        m_min = std::numeric_limits<double>::infinity ();
+      }
+    return true;
+  }
+
+private:
+  static uint32_t Buckets (void)
+  {
+    return (MAX_EXP - MIN_EXP) * SUB_BUCKETS;
+  }
+
+  // Bucket of a positive value
+  static uint32_t Index (double value)
+  {
+    int exp;
+    double mantissa = std::frexp (value, &exp);   // value = mantissa * 2^exp, mantissa in [0.5, 1)
+    if (exp <= MIN_EXP)
+      {
+        return 0;
+      }
+    if (exp > MAX_EXP)
+      {
+        return Buckets () - 1;
+      }
+    uint32_t sub = static_cast<uint32_t> ((mantissa - 0.5) * 2 * SUB_BUCKETS);
+    return (exp - MIN_EXP - 1) * SUB_BUCKETS + std::min (sub, SUB_BUCKETS - 1);
+  }
+
+  static double Midpoint (uint32_t index)
+  {
+    int exp = static_cast<int> (index / SUB_BUCKETS) + MIN_EXP + 1;
+    double sub = index % SUB_BUCKETS;
+    return std::ldexp (0.5 + (sub + 0.5) / (2 * SUB_BUCKETS), exp);
+  }
+
+  // Make buckets first .. last available
+  void Grow (uint32_t first, uint32_t last)
+  {
+    if (m_counts.empty ())
+      {
+        m_offset = first;
+        m_counts.assign (last - first + 1, 0);
+        return;
+      }
+    if (first < m_offset)
+      {
+        m_counts.insert (m_counts.begin (), m_offset - first, 0);
+        m_offset = first;
+      }
+    if (last >= m_offset + m_counts.size ())
+      {
+        m_counts.resize (last - m_offset + 1, 0);
+      }
+  }
+
+  uint64_t m_count;
+  uint64_t m_zeros;                 //!< values at or below zero
+  double m_min;
+  double m_max;
+  double m_sum;
+  uint32_t m_offset;                //!< bucket of m_counts[0]
+  std::vector<uint64_t> m_counts;
+};
+
+} // namespace ns3
+
+#endif /* QUANTILE_SKETCH_H */
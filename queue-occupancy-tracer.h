@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef QUEUE_OCCUPANCY_TRACER_H
+#define QUEUE_OCCUPANCY_TRACER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/callback.h"
+#include "ns3/abort.h"
+#include "ns3/queue-disc.h"
+#include "trace-recorder.h"
+#include "decimated-plot.h"
+
+namespace ns3 {
+
+/**
+ * Exact occupancy of a queue disc, in packets.
+ *
+ * The tracer follows the queue disc's PacketsInQueue trace source, which
+ * changes on every enqueue, dequeue and drop of a queued packet, so it
+ * schedules no events of its own and sees every burst however short.
+ * It can
+ *  - write a (time, packets) line to a TraceRecorder on every change,
+ *  - add every change to a series of a DecimatedPlot, and
+ *  - write the minimum, maximum and time-weighted mean occupancy of each
+ *    fixed interval to a file.
+ * Intervals are closed lazily, on the next change or in Finish ().
+ */
+class QueueOccupancyTracer : public SimpleRefCount<QueueOccupancyTracer>
+{
+public:
+  /// Start following the queue disc now
+  QueueOccupancyTracer (Ptr<QueueDisc> queue)
+    : m_current (queue->GetNPackets ()),
+      m_start (Simulator::Now ()),
+      m_last (m_start),
+      m_area (0),
+      m_plotSeries (0),
+      m_file (0),
+      m_binArea (0),
+      m_binMin (m_current),
+      m_binMax (m_current)
+  {
+    queue->TraceConnectWithoutContext ("PacketsInQueue",
+                                       MakeCallback (&QueueOccupancyTracer::Changed, this));
+  }
+
+  ~QueueOccupancyTracer ()
+  {
+    if (m_file)
+      {
+        std::fclose (m_file);
+      }
+  }
+
+  /// Write every change of the occupancy to the recorder
+  void SetRecorder (Ptr<TraceRecorder> recorder)
+  {
+    m_recorder = recorder;
+    m_recorder->Record (m_current);
+  }
+
+  /// Add every change of the occupancy to series of the plot
+  void SetPlot (Ptr<DecimatedPlot> plot, uint32_t series)
+  {
+    m_plot = plot;
+    m_plotSeries = series;
+    m_plot->Record (m_plotSeries, m_current);
+  }
+
+  /**
+   * Write "end min max mean" per interval to filename, the interval end
+   * in seconds and the occupancy in packets.
+   */
+  void SetDownsampling (Time interval, std::string filename)
+  {
+    NS_ABORT_MSG_UNLESS (interval.IsStrictlyPositive (), "Downsampling interval must be positive");
+    m_file = std::fopen (filename.c_str (), "w");
+    NS_ABORT_MSG_UNLESS (m_file, "Cannot open " << filename);
+    m_interval = interval;
+    m_binEnd = m_start + interval;
+  }
+
+  /// Time-weighted mean occupancy from construction until now
+  double GetMean (void) const
+  {
+    Time now = Simulator::Now ();
+    if (now <= m_start)
+      {
+        return m_current;
+      }
+    double area = m_area + static_cast<double> (m_current) * (now - m_last).GetTimeStep ();
+    return area / (now - m_start).GetTimeStep ();
+  }
+
+  /// Close the intervals that ended by now; call once the simulation has run
+  void Finish (void)
+  {
+    Advance (Simulator::Now ());
+    if (m_file)
+      {
+        std::fflush (m_file);
+      }
+  }
+
+private:
+  void Changed (uint32_t oldValue, uint32_t newValue)
+  {
+    if (newValue == m_current)
+      {
+        return;
+      }
+    Advance (Simulator::Now ());
+    m_current = newValue;
+    m_binMin = std::min (m_binMin, newValue);
+    m_binMax = std::max (m_binMax, newValue);
+    if (m_recorder)
+      {
+        m_recorder->Record (newValue);
+      }
+    if (m_plot)
+      {
+        m_plot->Record (m_plotSeries, newValue);
+      }
+  }
+
+  // Account for the current occupancy up to time t
+  void Advance (Time t)
+  {
+    if (m_file)
+      {
+        while (t >= m_binEnd)
+          {
+            m_binArea += static_cast<double> (m_current) * (m_binEnd - m_last).GetTimeStep ();
+            m_area += static_cast<double> (m_current) * (m_binEnd - m_last).GetTimeStep ();
+            m_last = m_binEnd;
+            std::fprintf (m_file, "%g %u %u %g\n", m_binEnd.GetSeconds (), m_binMin, m_binMax,
+                          m_binArea / m_interval.GetTimeStep ());
+            m_binArea = 0;
+            m_binMin = m_current;
+            m_binMax = m_current;
+            m_binEnd += m_interval;
+          }
+        m_binArea += static_cast<double> (m_current) * (t - m_last).GetTimeStep ();
+      }
+    m_area += static_cast<double> (m_current) * (t - m_last).GetTimeStep ();
+    m_last = t;
+  }
+
+  uint32_t m_current;
+  Time m_start;
+  Time m_last;                       //!< time up to which the areas are accounted
+  double m_area;                     //!< packets x time steps since m_start
+  Ptr<TraceRecorder> m_recorder;
+  Ptr<DecimatedPlot> m_plot;
+  uint32_t m_plotSeries;
+  std::FILE *m_file;
+  Time m_interval;
+  Time m_binEnd;
+  double m_binArea;
+  uint32_t m_binMin;
+  uint32_t m_binMax;
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_OCCUPANCY_TRACER_H */
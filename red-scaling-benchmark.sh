@@ -0,0 +1,16 @@
+#!/bin/sh
+#
+# Measure how REDvsFIFO scales with the number of flows.
+#
+# Run from the top of an ns-3 tree whose scratch/ directory holds these
+# examples.  Each run prints the flow count, topology build time, run
+# time, events, events per wall-clock second and peak RSS.
+
+WAF=${WAF:-./waf}
+FLOWS=${FLOWS:-"5 50 200 500 1000 2000"}
+
+for n in $FLOWS
+do
+  echo "== REDvsFIFO, nFlows=$n"
+  $WAF --run "scratch/REDvsFIFO --nFlows=$n --printStats" || exit 1
+done
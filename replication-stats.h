@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef REPLICATION_STATS_H
+#define REPLICATION_STATS_H
+
+#include <cmath>
+#include <stdint.h>
+
+namespace ns3 {
+
+/// Two-sided 95% quantile of Student's t distribution
+inline double
+StudentT95 (uint32_t dof)
+{
+  static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  if (dof == 0)
+    {
+      return table[0];
+    }
+  return dof <= 30 ? table[dof - 1] : 1.96;
+}
+
+/**
+ * Mean and 95% confidence interval of independent observations, such
+ * as one metric over the replications of an experiment.
+ */
+class ReplicationStats
+{
+public:
+  ReplicationStats ()
+    : m_n (0),
+      m_sum (0),
+      m_sumSq (0)
+  {
+  }
+
+  void Add (double x)
+  {
+    m_n++;
+    m_sum += x;
+    m_sumSq += x * x;
+  }
+
+  uint32_t GetCount (void) const
+  {
+    return m_n;
+  }
+
+  double GetMean (void) const
+  {
+    return m_n ? m_sum / m_n : 0;
+  }
+
+  /// Half-width of the 95% confidence interval of the mean
+  double GetHalfWidth (void) const
+  {
+    if (m_n < 2)
+      {
+        return 0;
+      }
+    double mean = GetMean ();
+    double var = (m_sumSq - m_n * mean * mean) / (m_n - 1);
+    return StudentT95 (m_n - 1) * std::sqrt (var > 0 ? var : 0) / std::sqrt (static_cast<double> (m_n));
+  }
+
+  /// True once the half-width is within precision times the mean
+  bool IsPrecise (double precision) const
+  {
+    return m_n >= 2 && GetHalfWidth () <= precision * std::fabs (GetMean ());
+  }
+
+private:
+  uint32_t m_n;
+  double m_sum;
+  double m_sumSq;
+};
+
+} // namespace ns3
+
+#endif /* REPLICATION_STATS_H */
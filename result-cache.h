@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ns3/type-id.h"
+#include "ns3/attribute.h"
+#include "ns3/abort.h"
+
+#ifdef __has_include
+#if __has_include("ns3/version.h")
+#include "ns3/version.h"
+#define RESULT_CACHE_HAVE_VERSION
+#endif
+#endif
+
+namespace ns3 {
+
+/**
+ * On-disk cache of simulation results, addressed by the text of the
+ * configuration that produced them.
+ *
+ * A result is stored in <dir>/<hash>.result, where hash is the 64-bit
+ * FNV-1a hash of the key text; the file repeats the key so a hash
+ * collision reads as a miss.  Files are written to a temporary name and
+ * renamed, so concurrent workers and interrupted runs never leave a
+ * partial entry, and a rerun of an interrupted sweep finds every point
+ * stored before the interruption.
+ *
+ * The key must cover everything the result depends on.  The code of the
+ * program itself is not part of it: use a new key prefix, or clear the
+ * directory, after changing the model.
+ */
+class ResultCache
+{
+public:
+  /// Cache in directory dir, created if needed; an empty dir disables the cache
+  ResultCache (std::string dir = "")
+    : m_dir (dir)
+  {
+    if (!m_dir.empty () && mkdir (m_dir.c_str (), 0755) != 0)
+      {
+        NS_ABORT_MSG_UNLESS (errno == EEXIST, "Cannot create " << m_dir << ": " << std::strerror (errno));
+      }
+  }
+
+  bool IsEnabled (void) const
+  {
+    return !m_dir.empty ();
+  }
+
+  /// Read the result stored for key into value
+  bool Lookup (const std::string &key, std::string *value) const
+  {
+    if (m_dir.empty ())
+      {
+        return false;
+      }
+    std::ifstream in (Path (key).c_str ());
+    std::string storedKey;
+    if (!std::getline (in, storedKey) || storedKey != key)
+      {
+        return false;
+      }
+    return static_cast<bool> (std::getline (in, *value));
+  }
+
+  /// Store the result of key; value must fit on one line
+  void Store (const std::string &key, const std::string &value) const
+  {
+    if (m_dir.empty ())
+      {
+        return;
+      }
+    std::string path = Path (key);
+    std::ostringstream tmp;
+    tmp << path << ".tmp." << getpid ();
+    {
+      std::ofstream out (tmp.str ().c_str (), std::ios::out | std::ios::trunc);
+      out << key << "\n" << value << "\n";
+      NS_ABORT_MSG_UNLESS (out.flush (), "Cannot write " << tmp.str ());
+    }
+    NS_ABORT_MSG_IF (std::rename (tmp.str ().c_str (), path.c_str ()) != 0, "Cannot rename " << tmp.str ());
+  }
+
+  /// 64-bit FNV-1a hash
+  static uint64_t Hash (const std::string &text)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::string::size_type i = 0; i < text.size (); i++)
+      {
+        hash ^= static_cast<unsigned char> (text[i]);
+        hash *= 1099511628211ULL;
+      }
+    return hash;
+  }
+
+  /**
+   * Text identifying the ns-3 build and the default value of every
+   * attribute, so results are keyed on --ns3::... overrides and
+   * Config::SetDefault () calls as well as on the ns-3 version.
+   */
+  static std::string GetEnvironment (void)
+  {
+    std::ostringstream defaults;
+    for (uint32_t i = 0; i < TypeId::GetRegisteredN (); i++)
+      {
+        TypeId tid = TypeId::GetRegistered (i);
+        for (uint32_t j = 0; j < tid.GetAttributeN (); j++)
+          {
+            struct TypeId::AttributeInformation info = tid.GetAttribute (j);
+            defaults << tid.GetName () << "::" << info.name << "="
+                     << info.initialValue->SerializeToString (info.checker) << ";";
+          }
+      }
+    std::ostringstream oss;
+#ifdef RESULT_CACHE_HAVE_VERSION
+    oss << "ns3=" << Version::LongVersion ();
+#else
+    oss << "ns3=unknown";
+#endif
+    oss << " defaults=" << std::hex << Hash (defaults.str ());
+    return oss.str ();
+  }
+
+private:
+  std::string Path (const std::string &key) const
+  {
+    char name[32];
+    std::snprintf (name, sizeof (name), "%016llx.result", static_cast<unsigned long long> (Hash (key)));
+    return m_dir + "/" + name;
+  }
+
+  std::string m_dir;
+};
+
+} // namespace ns3
+
+#endif /* RESULT_CACHE_H */
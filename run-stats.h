@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <sys/resource.h>
+
+namespace ns3 {
+
+/**
+ * Wall-clock and memory measurements of a simulation run.
+ *
+ * The wall clock starts when the object is constructed.  Peak RSS is
+ * the high-water mark of the calling process, so measure one run per
+ * process (for example in a ParallelRunner worker) to compare runs.
+ */
+class RunStats
+{
+public:
+  RunStats ()
+    : m_start (std::chrono::steady_clock::now ())
+  {
+  }
+
+  /// Restart the wall clock
+  void Reset (void)
+  {
+    m_start = std::chrono::steady_clock::now ();
+  }
+
+  /// Wall-clock seconds since construction or the last Reset ()
+  double GetWallSeconds (void) const
+  {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now () - m_start;
+    return d.count ();
+  }
+
+  /// Peak resident set size of this process in kilobytes
+  static long GetPeakRssKb (void)
+  {
+    struct rusage usage;
+    if (getrusage (RUSAGE_SELF, &usage) != 0)
+      {
+        return 0;
+      }
+    return usage.ru_maxrss;
+  }
+
+private:
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace ns3
+
+#endif /* RUN_STATS_H */
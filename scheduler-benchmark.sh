@@ -0,0 +1,21 @@
+#!/bin/sh
+#
+# Run every scenario under every event scheduler.
+#
+# Run from the top of an ns-3 tree whose scratch/ directory holds these
+# examples.  Each run prints its events, events per wall-clock second,
+# wall time and peak RSS.  The buffer-size sweep of tcp-performance runs
+# in-process, so each of its lines covers one sweep point.
+
+WAF=${WAF:-./waf}
+SCHEDULERS=${SCHEDULERS:-"map heap list calendar priority timerwheel"}
+
+for s in $SCHEDULERS
+do
+  echo "== tcp-performance, scheduler=$s"
+  $WAF --run "scratch/tcp-performance --printStats --scheduler=$s" || exit 1
+  echo "== tcp-performance2, scheduler=$s"
+  $WAF --run "scratch/tcp-performance2 --printStats --scheduler=$s" || exit 1
+  echo "== REDvsFIFO, scheduler=$s"
+  $WAF --run "scratch/REDvsFIFO --printStats --scheduler=$s" || exit 1
+done
@@ -0,0 +1,191 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef STEADY_STATE_MONITOR_H
+#define STEADY_STATE_MONITOR_H
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/callback.h"
+#include "replication-stats.h"
+
+namespace ns3 {
+
+/**
+ * Stop a simulation once the goodput of every flow has settled.
+ *
+ * Every sampling interval the monitor reads a cumulative delivery
+ * counter per flow (bytes or packets, the test does not depend on the
+ * unit).  Samples are grouped into batches; the first batch is dropped
+ * as warm-up.  Once the last NumBatches batch means of every flow have
+ * a 95% confidence interval whose half-width is within Precision of
+ * their mean, the monitor calls Simulator::Stop ().  A flow that has
+ * delivered nothing over those batches, because it has not started or
+ * is stalled in timeout backoff, is never steady, so such a run goes on
+ * to its stop time.
+ */
+class SteadyStateMonitor : public SimpleRefCount<SteadyStateMonitor>
+{
+public:
+  /// Returns the number of units a flow has delivered so far
+  typedef Callback<uint64_t> Counter;
+
+  /**
+   * \param interval sampling interval
+   * \param batchSize samples per batch
+   * \param numBatches batch means used for the confidence interval
+   * \param precision largest accepted half-width relative to the mean
+   */
+  SteadyStateMonitor (Time interval, uint32_t batchSize = 5, uint32_t numBatches = 5,
+                      double precision = 0.05)
+    : m_interval (interval),
+      m_batchSize (batchSize),
+      m_numBatches (numBatches < 2 ? 2 : numBatches),
+      m_precision (precision),
+      m_samples (0),
+      m_steady (false)
+  {
+  }
+
+  void AddFlow (Counter counter)
+  {
+    Flow flow;
+    flow.counter = counter;
+    flow.last = 0;
+    flow.batchSum = 0;
+    m_flows.push_back (flow);
+  }
+
+  /// Start sampling at the given time, once every flow is active
+  void Start (Time at)
+  {
+    Simulator::Schedule (at, &SteadyStateMonitor::Sample, Ptr<SteadyStateMonitor> (this));
+  }
+
+  bool IsSteady (void) const
+  {
+    return m_steady;
+  }
+
+  /// Simulation time at which steady state was declared
+  Time GetSteadyTime (void) const
+  {
+    return m_steadyTime;
+  }
+
+  /// Short text explaining why the run ended
+  std::string GetStopReason (void) const
+  {
+    std::ostringstream oss;
+    if (m_steady)
+      {
+        oss << "steady@" << m_steadyTime.GetSeconds ();
+      }
+    else
+      {
+        oss << "limit";
+      }
+    return oss.str ();
+  }
+
+private:
+  struct Flow
+  {
+    Counter counter;
+    uint64_t last;
+    double batchSum;
+    std::vector<double> batchMeans;
+  };
+
+  void Sample (void)
+  {
+    bool first = (m_samples == 0);
+    m_samples++;
+    for (size_t i = 0; i < m_flows.size (); i++)
+      {
+        Flow &flow = m_flows[i];
+        uint64_t now = flow.counter ();
+        if (!first)
+          {
+            flow.batchSum += (now - flow.last) / m_interval.GetSeconds ();
+          }
+        flow.last = now;
+      }
+
+    // The first sample only sets the baseline
+    if (!first && (m_samples - 1) % m_batchSize == 0)
+      {
+        for (size_t i = 0; i < m_flows.size (); i++)
+          {
+            m_flows[i].batchMeans.push_back (m_flows[i].batchSum / m_batchSize);
+            m_flows[i].batchSum = 0;
+          }
+        if (Converged ())
+          {
+            m_steady = true;
+            m_steadyTime = Simulator::Now ();
+            Simulator::Stop ();
+            return;
+          }
+      }
+    Simulator::Schedule (m_interval, &SteadyStateMonitor::Sample, Ptr<SteadyStateMonitor> (this));
+  }
+
+  bool Converged (void) const
+  {
+    for (size_t i = 0; i < m_flows.size (); i++)
+      {
+        const std::vector<double> &means = m_flows[i].batchMeans;
+        // Batch 0 is warm-up
+        if (means.size () < m_numBatches + 1)
+          {
+            return false;
+          }
+        ReplicationStats stats;
+        for (size_t j = means.size () - m_numBatches; j < means.size (); j++)
+          {
+            stats.Add (means[j]);
+          }
+        if (stats.GetMean () <= 0 || stats.GetHalfWidth () > m_precision * stats.GetMean ())
+          {
+            return false;
+          }
+      }
+    return !m_flows.empty ();
+  }
+
+  Time m_interval;
+  uint32_t m_batchSize;
+  uint32_t m_numBatches;
+  double m_precision;
+  uint32_t m_samples;
+  bool m_steady;
+  Time m_steadyTime;
+  std::vector<Flow> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* STEADY_STATE_MONITOR_H */
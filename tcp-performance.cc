@@ -20,8 +20,13 @@
  */
 
 //Include necessary header files
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <iostream>
 #include <string>
+#include <sstream>
+#include <vector>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
@@ -31,6 +36,18 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/gnuplot.h"
+#include "parallel-runner.h"
+#include "trace-recorder.h"
+#include "run-stats.h"
+#include "steady-state-monitor.h"
+#include "adaptive-sweep.h"
+#include "timer-wheel-scheduler.h"
+#include "profiling-scheduler.h"
+#include "result-cache.h"
+#include "decimated-plot.h"
+#include "quantile-sketch.h"
+#include "my-app.h"
+#include "allocation-counter.h"
 
 //Use ns3 namespace
 using namespace ns3;
@@ -38,231 +55,631 @@ using namespace ns3;
 //Enable log for this program
 NS_LOG_COMPONENT_DEFINE ("tcp-performance");
 
-//Create an application to generate traffic
-class MyApp : public Application
+//Trace Sink
+static void
+CwndChange (Ptr<TraceRecorder> recorder, uint32_t oldCwnd, uint32_t newCwnd)
 {
-public:
-  MyApp ();
-  virtual ~MyApp ();
-
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
- 
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-  
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-};
+  recorder->Record (newCwnd / 480.0);
+}
 
-MyApp::MyApp ()
-  : m_socket (0),
-  m_peer (),
-  m_packetSize (0),
-  m_nPackets (0),
-  m_dataRate (0),
-  m_sendEvent (),
-  m_running (false),
-  m_packetsSent (0)
+static void
+CwndPlot (Ptr<DecimatedPlot> plot, uint32_t oldCwnd, uint32_t newCwnd)
 {
+  plot->Record (0, newCwnd / 480.0);
 }
 
-MyApp::~MyApp ()
+// Point-to-point channel attributes; delay2 and rate2 are the defaults
+// of the bottleneck link
+std::string delay1 = "1ms";
+std::string rate1 = "10Mbps";
+
+std::string delay2 = "3ms";
+std::string rate2 = "1Mbps";
+
+// Parameters of one simulation run
+struct RunConfig
 {
-  m_socket = 0;
+  uint32_t bufSize;
+  DataRate rate2;
+  Time delay2;
+  uint64_t run;
+};
+
+// Counters of the sweep flow, kept at the source socket and the sink
+struct FlowProbe
+{
+  uint64_t txPackets;
+  uint64_t rxPackets;
+  uint64_t rxBytes;
+  Time firstTx;
+  Time lastRx;
+  QuantileSketch rtt;           //!< RTT estimates of the source socket (s)
+};
+
+// Outcome of one simulation run
+struct RunResult
+{
+  double tput;
+  FlowProbe probe;
+  std::string stopReason;
+};
+
+// Segment sent by the source socket, retransmissions included
+static void
+ProbeTx (FlowProbe *probe, Ptr<const Packet> packet, const TcpHeader &header, Ptr<const TcpSocketBase> socket)
+{
+  if (probe->txPackets++ == 0)
+    {
+      probe->firstTx = Simulator::Now ();
+    }
 }
 
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
+// Data delivered to the sink application
+static void
+ProbeRx (FlowProbe *probe, Ptr<const Packet> packet, const Address &from)
 {
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
+  probe->rxPackets++;
+  probe->rxBytes += packet->GetSize ();
+  probe->lastRx = Simulator::Now ();
 }
 
-void
-MyApp::StartApplication (void)
+// New RTT estimate of the source socket, taken on every ACK
+static void
+ProbeRtt (FlowProbe *probe, Time oldRtt, Time newRtt)
 {
-  m_running = true;
-  m_packetsSent = 0;
-  m_socket->Bind ();
-  m_socket->Connect (m_peer);
-  SendPacket ();
+  probe->rtt.Add (newRtt.GetSeconds ());
 }
 
-void
-MyApp::StopApplication (void)
+// Buffer size sweep: 0 to 33 segments of 1500 bytes
+const uint32_t bufStep = 1500;
+const uint32_t nBufSizes = 34;
+
+// Write the congestion window of every sweep point to cwnd1-<bufSize>.plotme
+bool traceCwnd = false;
+
+// Format of the cwnd trace: text (.plotme) or binary (.bintrace)
+std::string traceFormat = "text";
+
+// Decimation of the congestion window plotted into cwnd1-<bufSize>.plt;
+// empty writes no plot
+std::string plotMethod;
+
+// Draw MyApp packets from a recycled pool
+bool packetPool = false;
+
+// Packets MyApp sends per timer event
+uint32_t burst = 1;
+
+// Print allocation and memory statistics of every sweep point
+bool printStats = false;
+
+// Also install FlowMonitor on every node and write one XML file per point
+bool enableFlowMonitor = false;
+
+// Stop each run once the goodput has reached steady state
+bool steadyState = false;
+double ssInterval = 0.05;
+double ssPrecision = 0.05;
+
+// RngRun of the first sweep point; point i uses firstRun + i
+uint64_t firstRun = 1;
+
+// Run the simulation for one sweep point
+static RunResult
+RunSimulation (const RunConfig &config)
 {
-  m_running = false;
+  RunStats runStats;
+  uint64_t allocations = AllocationCounter::Get ();
+  RngSeedManager::SetRun (config.run);
+  uint32_t bufSize = config.bufSize;
+
+  //Create nodes
+  NS_LOG_INFO ("Create nodes.");
+  NodeContainer c;
+  c.Create (4);
+
+  //Create Node Containers for nodes in the point-to-point channel
+  NodeContainer n0n1 = NodeContainer (c.Get (0), c.Get (1));
+  NodeContainer n1n2 = NodeContainer (c.Get (1), c.Get (2));
+  NodeContainer n2n3 = NodeContainer (c.Get (3), c.Get (2));
+
+  // Create point-to-point channel and configure its attributes
+  NS_LOG_INFO ("Create channels.");
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue (rate1));
+  p2p.SetChannelAttribute ("Delay", StringValue (delay1));
+
+  PointToPointHelper p2p2;
+  p2p2.SetDeviceAttribute ("DataRate", DataRateValue (config.rate2));
+  p2p2.SetChannelAttribute ("Delay", TimeValue (config.delay2));
+
+  // Create network device container for nodes
+  NetDeviceContainer d0d1 = p2p.Install (n0n1);
+  NetDeviceContainer d1d2 = p2p2.Install (n1n2);
+  NetDeviceContainer d2d3 = p2p.Install (n2n3);
+
+  // Install Internet Stack
+  InternetStackHelper internet;
+  internet.Install (c);
+
+  // Assign IP address to every interface in point-to-point network
+  NS_LOG_INFO ("Assign IP Addresses.");
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i0i1 = ipv4.Assign (d0d1);
+
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer i1i2 = ipv4.Assign (d1d2);
+
+  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
+  Ipv4InterfaceContainer i2i3 = ipv4.Assign (d2d3);
+
+  // Initialize routing table for each node
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  //Create a PacketSinkApplication and install it on node 3
+  uint16_t sinkPort1 = 8081;
+  Address sinkAddress1 (InetSocketAddress (i2i3.GetAddress (0), sinkPort1));
+  PacketSinkHelper packetSinkHelper1 ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort1));
+  ApplicationContainer sinkApps1 = packetSinkHelper1.Install (c.Get (3));
+  sinkApps1.Start (Seconds (0.));
+  sinkApps1.Stop (Seconds (10.));
+
+  Ptr<Socket> ns3TcpSocket1 = Socket::CreateSocket (c.Get (0), TcpSocketFactory::GetTypeId ());
+
+  //Set the maximum transmit and receive buffer size
+  ns3TcpSocket1->SetAttribute ("SndBufSize",  ns3::UintegerValue (bufSize));
+  ns3TcpSocket1->SetAttribute ("RcvBufSize",  ns3::UintegerValue (bufSize));
+
+  //Connect the congestion window trace source to sink
+  if (traceCwnd)
+    {
+      std::ostringstream cwndFile;
+      cwndFile << "cwnd1-" << bufSize << (traceFormat == "binary" ? ".bintrace" : ".plotme");
+      Ptr<TraceRecorder> cwndRecorder = Create<TraceRecorder> (cwndFile.str (), '\t');
+      cwndRecorder->CloseOnDestroy ();
+      ns3TcpSocket1->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndChange, cwndRecorder));
+    }
+  if (!plotMethod.empty ())
+    {
+      std::ostringstream plotName;
+      plotName << "cwnd1-" << bufSize;
+      std::ostringstream title;
+      title << "Congestion window, buffer " << bufSize << " bytes";
+      Ptr<DecimatedPlot> cwndPlot = Create<DecimatedPlot> (plotName.str (), title.str (), "Time (s)", "cwnd (segments)",
+                                                           DecimatedPlot::ParseMethod (plotMethod));
+      cwndPlot->AddSeries ("cwnd", Gnuplot2dDataset::STEPS);
+      cwndPlot->WriteOnDestroy ();
+      ns3TcpSocket1->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndPlot, cwndPlot));
+    }
 
-  if (m_sendEvent.IsRunning ())
+  //Create an object of class MyApp
+  Ptr<MyApp> app1 = CreateObject<MyApp> ();
+  app1->Setup (ns3TcpSocket1, sinkAddress1, 1040, 1000000, DataRate ("20Mbps"));
+  app1->SetPacketPool (packetPool);
+  app1->SetBurst (burst);
+  c.Get (0)->AddApplication (app1);
+  app1->SetStartTime (Seconds (1.));
+  app1->SetStopTime (Seconds (10.));
+
+  // Stop early once the goodput at the sink has settled
+  Ptr<SteadyStateMonitor> monitor;
+  if (steadyState)
     {
-      Simulator::Cancel (m_sendEvent);
+      monitor = Create<SteadyStateMonitor> (Seconds (ssInterval), 5, 5, ssPrecision);
+      monitor->AddFlow (MakeCallback (&PacketSink::GetTotalRx, DynamicCast<PacketSink> (sinkApps1.Get (0))));
+      monitor->Start (Seconds (1.));
     }
 
-  if (m_socket)
+  // Count the flow at the source socket and the sink only
+  FlowProbe probe = FlowProbe ();
+  ns3TcpSocket1->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&ProbeTx, &probe));
+  sinkApps1.Get (0)->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&ProbeRx, &probe));
+  ns3TcpSocket1->TraceConnectWithoutContext ("RTT", MakeBoundCallback (&ProbeRtt, &probe));
+
+  // Enable Flowmonitor
+  Ptr<FlowMonitor> flowMonitor;
+  FlowMonitorHelper flowHelper;
+  if (enableFlowMonitor)
     {
-      m_socket->Close ();
+      flowMonitor = flowHelper.InstallAll ();
     }
-}
 
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
+  NS_LOG_INFO ("Run Simulation.");
+  Simulator::Stop (Seconds (15.0));
+
+  //Run the simulation
+  Simulator::Run ();
+
+  //Calculation of throughput: bytes delivered to the sink between the
+  //first segment sent and the last one received
+  double TPut = 0;
+  if (probe.rxBytes > 0)
+    {
+      TPut = probe.rxBytes * 8.0 / (probe.lastRx - probe.firstTx).GetSeconds ();
+    }
+
+  if (printStats)
+    {
+      double wall = runStats.GetWallSeconds ();
+      std::cout << "bufSize " << bufSize
+                << " packets " << app1->GetPacketsSent ()
+                << " created " << app1->GetPacketsAllocated ()
+                << " poolHits " << app1->GetPoolHits ()
+                << " allocs " << AllocationCounter::Get () - allocations
+                << " allocs/s " << (AllocationCounter::Get () - allocations) / wall
+                << " events " << Simulator::GetEventCount ()
+                << " events/s " << Simulator::GetEventCount () / wall
+                << " wall " << wall << " s"
+                << " peakRss " << RunStats::GetPeakRssKb () << " kB" << std::endl;
+    }
 
-  if (++m_packetsSent < m_nPackets)
+  //Serialize results to a file
+  if (flowMonitor)
     {
-      ScheduleTx ();
+      flowMonitor->CheckForLostPackets ();
+      std::ostringstream flowmonFile;
+      flowmonFile << "tcp-performance-" << bufSize << ".flowmon";
+      flowMonitor->SerializeToXmlFile (flowmonFile.str (), true, true);
     }
+
+  //Release resources at the end of simulation
+  Simulator::Destroy ();
+
+  RunResult result;
+  result.tput = TPut;
+  result.probe = probe;
+  result.stopReason = monitor ? monitor->GetStopReason () : "";
+  return result;
+}
+
+// Sweep points of the current batch, shared with the worker processes
+std::vector<RunConfig> batch;
+
+// Results of earlier runs, and the environment part of their keys
+ResultCache cache;
+std::string cacheEnvironment;
+
+// Text form of a result, used between the workers and the parent
+static std::string
+SerializeResult (const RunResult &result)
+{
+  std::ostringstream oss;
+  oss.precision (17);
+  oss << result.tput << " " << result.probe.txPackets << " " << result.probe.rxPackets
+      << " " << result.probe.rxBytes << " " << result.probe.firstTx.GetTimeStep ()
+      << " " << result.probe.lastRx.GetTimeStep () << " " << result.probe.rtt.Serialize ()
+      << " " << result.stopReason;
+  return oss.str ();
 }
 
-void
-MyApp::ScheduleTx (void)
+static RunResult
+ParseResult (std::string text)
 {
-  if (m_running)
+  RunResult result;
+  int64_t firstTx = 0;
+  int64_t lastRx = 0;
+  std::istringstream iss (text);
+  iss >> result.tput >> result.probe.txPackets >> result.probe.rxPackets
+      >> result.probe.rxBytes >> firstTx >> lastRx;
+  result.probe.rtt.Parse (iss);
+  iss >> result.stopReason;
+  result.probe.firstTx = TimeStep (firstTx);
+  result.probe.lastRx = TimeStep (lastRx);
+  return result;
+}
+
+// Everything the result of a run depends on
+static std::string
+CacheKey (const RunConfig &config)
+{
+  std::ostringstream oss;
+  oss << "tcp-performance-v3 " << cacheEnvironment
+      << " rate1=" << rate1 << " delay1=" << delay1
+      << " rate2=" << config.rate2.GetBitRate () << " delay2=" << config.delay2.GetTimeStep ()
+      << " bufSize=" << config.bufSize
+      << " seed=" << RngSeedManager::GetSeed () << " run=" << config.run
+      << " burst=" << burst << " steadyState=" << steadyState;
+  if (steadyState)
     {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
+      oss << " ssInterval=" << ssInterval << " ssPrecision=" << ssPrecision;
     }
+  return oss.str ();
 }
 
-//Trace Sink
-/*static void
-CwndChange (uint32_t oldCwnd, uint32_t newCwnd)
+// Simulate one point and store its result in the cache
+static std::string
+RunAndStore (const RunConfig &config)
 {
-  std::ofstream tmpfile ("cwnd1.plotme", std::ios::in |std::ios::out | std::ios::app);
-  tmpfile << Simulator::Now ().GetSeconds () << "\t" << (newCwnd/480.0) << "\n";
-  tmpfile.close();
-}*/
+  std::string text = SerializeResult (RunSimulation (config));
+  cache.Store (CacheKey (config), text);
+  return text;
+}
 
-//Main function
-int main (int argc, char *argv[])
+// Points of the batch that are not in the cache
+std::vector<uint32_t> pending;
+
+// Job body for the worker pool: job i simulates batch[pending[i]].  The
+// worker stores its result, so an interrupted sweep keeps finished points.
+static std::string
+RunBatchPoint (uint32_t index)
 {
-  //Set point-to-point channel attributes
-  std::string delay1 = "1ms";
-  std::string rate1 = "10Mbps";
+  return RunAndStore (batch[pending[index]]);
+}
 
-  std::string delay2 = "3ms";
-  std::string rate2 = "1Mbps";
+// Simulate every point of the batch that is not cached, in process or
+// on the worker pool
+static std::vector<RunResult>
+RunBatch (uint32_t jobs)
+{
+  std::vector<std::string> texts (batch.size ());
+  pending.clear ();
+  for (uint32_t i = 0; i < batch.size (); i++)
+    {
+      // Cached points would not write their cwnd or FlowMonitor files
+      if (traceCwnd || !plotMethod.empty () || enableFlowMonitor || !cache.Lookup (CacheKey (batch[i]), &texts[i]))
+        {
+          pending.push_back (i);
+        }
+    }
+  if (cache.IsEnabled ())
+    {
+      NS_LOG_INFO ((batch.size () - pending.size ()) << " of " << batch.size () << " points cached.");
+    }
 
-  for (int bufSize = 0 * 1500; bufSize <= 33 * 1500;)
+  if (jobs == 1)
     {
-      CommandLine cmd;
-      cmd.Parse (argc, argv);
-
-      //Create nodes
-      NS_LOG_INFO ("Create nodes.");
-      NodeContainer c;
-      c.Create (4);
-
-      //Create Node Containers for nodes in the point-to-point channel
-      NodeContainer n0n1 = NodeContainer (c.Get (0), c.Get (1));
-      NodeContainer n1n2 = NodeContainer (c.Get (1), c.Get (2));
-      NodeContainer n2n3 = NodeContainer (c.Get (3), c.Get (2));
-
-      // Create point-to-point channel and configure its attributes
-      NS_LOG_INFO ("Create channels.");
-      PointToPointHelper p2p;
-      p2p.SetDeviceAttribute ("DataRate", StringValue (rate1));
-      p2p.SetChannelAttribute ("Delay", StringValue (delay1));
-
-      PointToPointHelper p2p2;
-      p2p2.SetDeviceAttribute ("DataRate", StringValue (rate2));
-      p2p2.SetChannelAttribute ("Delay", StringValue (delay2));
-
-      // Create network device container for nodes
-      NetDeviceContainer d0d1 = p2p.Install (n0n1);
-      NetDeviceContainer d1d2 = p2p2.Install (n1n2);
-      NetDeviceContainer d2d3 = p2p.Install (n2n3);
-
-      // Install Internet Stack
-      InternetStackHelper internet;
-      internet.Install (c);
-
-      // Assign IP address to every interface in point-to-point network
-      NS_LOG_INFO ("Assign IP Addresses.");
-      Ipv4AddressHelper ipv4;
-      ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-      Ipv4InterfaceContainer i0i1 = ipv4.Assign (d0d1);
-
-      ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-      Ipv4InterfaceContainer i1i2 = ipv4.Assign (d1d2);
-
-      ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-      Ipv4InterfaceContainer i2i3 = ipv4.Assign (d2d3);
-
-      // Initialize routing table for each node
-      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
-
-      //Create a PacketSinkApplication and install it on node 3
-      uint16_t sinkPort1 = 8081;
-      Address sinkAddress1 (InetSocketAddress (i2i3.GetAddress (0), sinkPort1));
-      PacketSinkHelper packetSinkHelper1 ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort1));
-      ApplicationContainer sinkApps1 = packetSinkHelper1.Install (c.Get (3));
-      sinkApps1.Start (Seconds (0.));
-      sinkApps1.Stop (Seconds (10.));
-
-      Ptr<Socket> ns3TcpSocket1 = Socket::CreateSocket (c.Get (0), TcpSocketFactory::GetTypeId ());
-
-      //Set the maximum transmit and receive buffer size
-      ns3TcpSocket1->SetAttribute ("SndBufSize",  ns3::UintegerValue (bufSize));
-      ns3TcpSocket1->SetAttribute ("RcvBufSize",  ns3::UintegerValue (bufSize));
-
-      //Connect the congestion window trace source to sink
-      //ns3TcpSocket1->TraceConnectWithoutContext ("CongestionWindow", MakeCallback (&CwndChange));
-
-      //Create an object of class MyApp
-      Ptr<MyApp> app1 = CreateObject<MyApp> ();
-      app1->Setup (ns3TcpSocket1, sinkAddress1, 1040, 1000000, DataRate ("20Mbps"));
-      c.Get (0)->AddApplication (app1);
-      app1->SetStartTime (Seconds (1.));
-      app1->SetStopTime (Seconds (10.));
-
-      // Enable Flowmonitor
-      Ptr<FlowMonitor> flowMonitor;
-      FlowMonitorHelper flowHelper;
-      flowMonitor = flowHelper.InstallAll ();
+      for (uint32_t i = 0; i < pending.size (); i++)
+        {
+          texts[pending[i]] = RunAndStore (batch[pending[i]]);
+        }
+    }
+  else if (!pending.empty ())
+    {
+      ParallelRunner runner (jobs);
+      NS_LOG_INFO ("Run " << pending.size () << " points on " << runner.GetMaxWorkers () << " workers.");
+      std::vector<std::string> done = runner.Run (pending.size (), MakeCallback (&RunBatchPoint));
+      for (uint32_t i = 0; i < done.size (); i++)
+        {
+          texts[pending[i]] = done[i];
+        }
+    }
 
-      NS_LOG_INFO ("Run Simulation.");
-      Simulator::Stop (Seconds (15.0));
+  std::vector<RunResult> results;
+  for (uint32_t i = 0; i < texts.size (); i++)
+    {
+      results.push_back (ParseResult (texts[i]));
+    }
+  return results;
+}
 
-      //Run the simulation
-      Simulator::Run ();
+// Fluid-model prediction of one sweep point
+struct FluidPrediction
+{
+  double tput;
+  bool uncertain;
+};
 
-      flowMonitor->CheckForLostPackets ();
+// Current default of a TcpSocket attribute, as set on the command line
+static uint32_t
+TcpSocketDefault (std::string name)
+{
+  struct TypeId::AttributeInformation info;
+  NS_ABORT_MSG_UNLESS (TcpSocket::GetTypeId ().LookupAttributeByName (name, &info), "No TcpSocket attribute " << name);
+  return DynamicCast<const UintegerValue> (info.initialValue)->Get ();
+}
+
+// Throughput of the sweep flow once slow start is over: the window is
+// the buffer size, so the flow delivers min (bottleneck goodput,
+// bufSize / RTT).  Points are uncertain within margin of the knee, where
+// queueing at the bottleneck sets the RTT, and below four segments,
+// where delayed ACKs and partial segments dominate.
+static FluidPrediction
+PredictThroughput (const RunConfig &config, double margin)
+{
+  // IPv4, TCP with timestamps, and PPP headers
+  const double headers = 20 + 32 + 2;
+  double mss = TcpSocketDefault ("SegmentSize");
+  double rate1bps = DataRate (rate1).GetBitRate ();
+  double rate2bps = config.rate2.GetBitRate ();
+
+  double goodput = rate2bps * mss / (mss + headers);
+  double rtt = 2 * (2 * Time (delay1).GetSeconds () + config.delay2.GetSeconds ())
+    + (mss + 2 * headers) * 8 * (2 / rate1bps + 1 / rate2bps);
+  double windowLimited = config.bufSize * 8.0 / rtt;
+
+  FluidPrediction prediction;
+  prediction.tput = std::min (goodput, windowLimited);
+  prediction.uncertain = config.bufSize < 4 * mss || std::fabs (windowLimited - goodput) <= margin * goodput;
+  return prediction;
+}
+
+//Main function
+int main (int argc, char *argv[])
+{
+  uint32_t jobs = 1;
+  std::string sweepMode = "grid";
+  std::string bufRange = "0:49500:1500";
+  std::string rateRange;
+  std::string delayRange;
+  uint32_t sweepBudget = 200;
+  double sweepTolerance = 0.02;
+  std::string scheduler = "map";
+  std::string profile;
+  std::string model = "sim";
+  double modelMargin = 0.25;
+  uint32_t modelCheck = 8;
+  std::string cacheDir;
+
+  CommandLine cmd;
+  cmd.AddValue ("rate2", "Data rate of the bottleneck link", rate2);
+  cmd.AddValue ("delay2", "Delay of the bottleneck link", delay2);
+  cmd.AddValue ("traceCwnd", "Write the congestion window of every sweep point to cwnd1-<bufSize>.plotme", traceCwnd);
+  cmd.AddValue ("traceFormat", "Format of the cwnd trace: text (.plotme) or binary (.bintrace, read with bintrace)", traceFormat);
+  cmd.AddValue ("plot", "Write cwnd1-<bufSize>.plt, a gnuplot script of the congestion window decimated with minmax or lttb", plotMethod);
+  cmd.AddValue ("packetPool", "Draw MyApp packets from a recycled pool", packetPool);
+  cmd.AddValue ("burst", "Packets MyApp sends per timer event, at the same average rate", burst);
+  cmd.AddValue ("printStats", "Print packets created and reused by MyApp, heap allocations, events per second, wall time and peak RSS of every sweep point", printStats);
+  cmd.AddValue ("flowMonitor", "Also install FlowMonitor on every node and write tcp-performance-<bufSize>.flowmon", enableFlowMonitor);
+  cmd.AddValue ("steadyState", "Stop each run once the goodput has reached steady state; the stop reason is written as a third column of tput.plotme", steadyState);
+  cmd.AddValue ("ssInterval", "Goodput sampling interval of the steady-state test in seconds", ssInterval);
+  cmd.AddValue ("ssPrecision", "Largest 95% confidence half-width of the steady-state test, relative to the mean goodput", ssPrecision);
+  cmd.AddValue ("jobs", "Number of sweep points simulated in parallel worker processes (0 = one per core)", jobs);
+  cmd.AddValue ("sweep", "Sweep mode: grid (buffer sizes 0 to 33 x 1500 bytes, tput.plotme) or adaptive (sweep.plotme)", sweepMode);
+  cmd.AddValue ("bufRange", "Adaptive sweep: buffer size range in bytes, lo:hi[:step]", bufRange);
+  cmd.AddValue ("rateRange", "Adaptive sweep: bottleneck rate range in bps, lo:hi[:step] (default: fixed at rate2)", rateRange);
+  cmd.AddValue ("delayRange", "Adaptive sweep: bottleneck delay range in ms, lo:hi[:step] (default: fixed at delay2)", delayRange);
+  cmd.AddValue ("sweepBudget", "Adaptive sweep: maximum number of simulated points", sweepBudget);
+  cmd.AddValue ("sweepTolerance", "Adaptive sweep: smallest throughput change, relative to the overall range, that is refined", sweepTolerance);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar, priority or timerwheel", scheduler);
+  cmd.AddValue ("profile", "Profile wall time per event type into <profile>.txt and <profile>.folded", profile);
+  cmd.AddValue ("model", "Grid sweep: sim (simulate every point), fluid (predict every point) or hybrid (simulate only uncertain predictions)", model);
+  cmd.AddValue ("modelMargin", "Predictions within this fraction of the bottleneck rate around the knee are uncertain", modelMargin);
+  cmd.AddValue ("modelCheck", "Hybrid model: also simulate every n-th point to cross-check the model (0 = never)", modelCheck);
+  cmd.AddValue ("cache", "Directory of cached sweep point results; cached points are not simulated again", cacheDir);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_UNLESS (traceFormat == "text" || traceFormat == "binary", "Unknown trace format " << traceFormat);
+  if (!plotMethod.empty ())
+    {
+      DecimatedPlot::ParseMethod (plotMethod);
+    }
+  SelectScheduler (scheduler);
+  if (!profile.empty ())
+    {
+      ProfilingScheduler::Enable (profile);
+    }
 
-      double TPut;
-      Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
-      std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
+  firstRun = RngSeedManager::GetRun ();
+  cache = ResultCache (cacheDir);
+  if (cache.IsEnabled ())
+    {
+      cacheEnvironment = ResultCache::GetEnvironment ();
+    }
 
-      //Calculation of throughput
-      TPut = stats[1].rxBytes * 8.0 / (stats[1].timeLastRxPacket.GetSeconds () - stats[1].timeFirstTxPacket.GetSeconds ());
+  if (sweepMode == "adaptive")
+    {
+      AdaptiveSweep sweep (sweepBudget, sweepTolerance);
+      NS_ABORT_MSG_UNLESS (sweep.AddDimension ("bufSize", bufRange, 0), "Bad bufRange " << bufRange);
+      NS_ABORT_MSG_UNLESS (sweep.AddDimension ("rate2", rateRange, DataRate (rate2).GetBitRate ()), "Bad rateRange " << rateRange);
+      NS_ABORT_MSG_UNLESS (sweep.AddDimension ("delay2", delayRange, Time (delay2).GetSeconds () * 1000), "Bad delayRange " << delayRange);
+
+      uint64_t run = firstRun;
+      std::vector<AdaptiveSweep::Point> points;
+      while (!(points = sweep.NextBatch ()).empty ())
+        {
+          batch.clear ();
+          for (uint32_t i = 0; i < points.size (); i++)
+            {
+              std::vector<double> values = sweep.GetValues (points[i]);
+              RunConfig config;
+              config.bufSize = static_cast<uint32_t> (values[0]);
+              config.rate2 = DataRate (static_cast<uint64_t> (values[1]));
+              config.delay2 = Seconds (values[2] / 1000);
+              config.run = run++;
+              batch.push_back (config);
+            }
+          std::vector<RunResult> results = RunBatch (jobs);
+          for (uint32_t i = 0; i < points.size (); i++)
+            {
+              sweep.SetResult (points[i], results[i].tput);
+            }
+        }
+
+      //Write buffer size (KB), bottleneck rate (Mbps), delay (ms) and throughput (Kbps)
+      std::ofstream sweepFile ("sweep.plotme", std::ios::out | std::ios::trunc);
+      const std::map<AdaptiveSweep::Point, double> &results = sweep.GetResults ();
+      for (std::map<AdaptiveSweep::Point, double>::const_iterator it = results.begin (); it != results.end (); ++it)
+        {
+          std::vector<double> values = sweep.GetValues (it->first);
+          sweepFile << (values[0] / 1000) << "\t" << (values[1] / 1e6) << "\t" << values[2]
+                    << "\t" << (it->second / 1000) << "\n";
+        }
+      sweepFile.close ();
+      NS_LOG_INFO ("Simulated " << results.size () << " points.");
+      return 0;
+    }
 
-      //Write values of buffer size and throughput into output file
-      std::ofstream tmp1file ("tput.plotme", std::ios::in | std::ios::out | std::ios::app);
-      tmp1file << (bufSize / 1000) << "\t" << (TPut / 1000) << "\n";
-      tmp1file.close ();
+  NS_ABORT_MSG_UNLESS (sweepMode == "grid", "Unknown sweep mode " << sweepMode);
+  NS_ABORT_MSG_UNLESS (model == "sim" || model == "fluid" || model == "hybrid", "Unknown model " << model);
+  std::vector<RunConfig> configs;
+  std::vector<FluidPrediction> predictions;
+  std::vector<int> simulated;   // index into batch, or -1 for predicted points
+  for (uint32_t i = 0; i < nBufSizes; i++)
+    {
+      RunConfig config;
+      config.bufSize = i * bufStep;
+      config.rate2 = DataRate (rate2);
+      config.delay2 = Time (delay2);
+      config.run = firstRun + i;
+      configs.push_back (config);
+      predictions.push_back (PredictThroughput (config, modelMargin));
+
+      bool simulate = model == "sim"
+        || (model == "hybrid" && (predictions[i].uncertain || (modelCheck > 0 && i % modelCheck == 0)));
+      simulated.push_back (simulate ? batch.size () : -1);
+      if (simulate)
+        {
+          batch.push_back (config);
+        }
+    }
+  std::vector<RunResult> results = RunBatch (jobs);
 
-      //Serialize results to a file
-      flowMonitor->SerializeToXmlFile ("tcp-performance.flowmon", true, true);
+  //Write values of buffer size and throughput into output file; predicted
+  //points are marked fluid in the third column
+  std::ofstream tmp1file ("tput.plotme", std::ios::out | std::ios::trunc);
+  for (uint32_t i = 0; i < configs.size (); i++)
+    {
+      double tput = simulated[i] < 0 ? predictions[i].tput : results[simulated[i]].tput;
+      std::string reason = simulated[i] < 0 ? "fluid" : results[simulated[i]].stopReason;
+      tmp1file << (configs[i].bufSize / 1000) << "\t" << (tput / 1000);
+      if (!reason.empty ())
+        {
+          tmp1file << "\t" << reason;
+        }
+      tmp1file << "\n";
+    }
+  tmp1file.close ();
 
-      //Release resources at the end of simulation
-      Simulator::Destroy ();
+  //One probe record per simulated point: buffer size (bytes), segments sent,
+  //segments and bytes received, first Tx and last Rx (s), throughput (bps),
+  //and the p50, p99 and p99.9 of the RTT estimates (s)
+  std::ofstream probeFile ("tcp-performance.probe", std::ios::out | std::ios::trunc);
+  for (uint32_t i = 0; i < results.size (); i++)
+    {
+      const FlowProbe &probe = results[i].probe;
+      probeFile << batch[i].bufSize << " " << probe.txPackets << " " << probe.rxPackets
+                << " " << probe.rxBytes << " " << probe.firstTx.GetSeconds ()
+                << " " << probe.lastRx.GetSeconds () << " " << results[i].tput
+                << " " << probe.rtt.GetQuantile (0.5) << " " << probe.rtt.GetQuantile (0.99)
+                << " " << probe.rtt.GetQuantile (0.999) << "\n";
+    }
+  probeFile.close ();
 
-      bufSize += 1 * 1500;
+  //Cross-check: buffer size (bytes), predicted throughput (bps), uncertain
+  //flag, simulated throughput (bps) and relative error, or - if predicted only
+  if (model != "sim")
+    {
+      std::ofstream modelFile ("tcp-performance.model", std::ios::out | std::ios::trunc);
+      double maxError = 0;
+      for (uint32_t i = 0; i < configs.size (); i++)
+        {
+          modelFile << configs[i].bufSize << " " << predictions[i].tput << " " << predictions[i].uncertain;
+          if (simulated[i] < 0)
+            {
+              modelFile << " - -\n";
+              continue;
+            }
+          double tput = results[simulated[i]].tput;
+          double error = tput > 0 ? std::fabs (predictions[i].tput - tput) / tput : 0;
+          modelFile << " " << tput << " " << error << "\n";
+          if (!predictions[i].uncertain)
+            {
+              maxError = std::max (maxError, error);
+            }
+        }
+      modelFile.close ();
+      std::cout << "Simulated " << results.size () << " of " << configs.size () << " points;"
+                << " largest model error at a certain point " << maxError * 100 << "%" << std::endl;
     }
 
   NS_LOG_INFO ("Done.");
@@ -30,7 +30,11 @@
 
 //Include necessary header files
 #include <fstream>
+#include <iostream>
 #include <string>
+#include <vector>
+#include <map>
+#include <sstream>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
@@ -40,6 +44,18 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/netanim-module.h"
 #include "ns3/mobility-module.h"
+#include "ns3/traffic-control-module.h"
+#include "run-stats.h"
+#include "steady-state-monitor.h"
+#include "throughput-aggregator.h"
+#include "pcap-capture.h"
+#include "video-trace.h"
+#include "timer-wheel-scheduler.h"
+#include "profiling-scheduler.h"
+#include "live-metrics-publisher.h"
+#include "branch-runner.h"
+#include "my-app.h"
+#include "allocation-counter.h"
 
 //Use ns3 namespace
 using namespace ns3;
@@ -47,115 +63,146 @@ using namespace ns3;
 //Enable log for this program
 NS_LOG_COMPONENT_DEFINE ("Prog2");
 
-// Application to generate TCP traffic
-class MyApp : public Application
+// Video bytes received so far, for the live metrics
+static uint64_t
+VideoBytes (Ptr<ThroughputAggregator> aggregator)
 {
-public:
-  MyApp ();
-  virtual ~MyApp ();
-
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-
-  void SendPacket (void);
-
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-
-};
-
-MyApp::MyApp ()
-  : m_socket (0),
-  m_peer (),
-  m_packetSize (0),
-  m_nPackets (0),
-  m_dataRate (0),
-  m_sendEvent (),
-  m_running (false),
-  m_packetsSent (0)
-
-{
-}
-
-MyApp::~MyApp ()
-{
-  m_socket = 0;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
+  return aggregator->GetTotalBytes (1);
 }
 
-void
-MyApp::StartApplication (void)
+// Checkpoint state that the what-if branches change
+struct BranchState
 {
+  std::vector<std::vector<std::pair<std::string, std::string> > > variants;
+  std::vector<std::string> labels;
+  NetDeviceContainer bottleneck;
+  Ptr<QueueDisc> bottleneckQueue;
+  Ptr<Application> video;
+  Ptr<PacketSink> sink;
+  Ptr<UdpServer> server;
+  Ptr<ThroughputAggregator> aggregator;
+  Ptr<LiveMetricsPublisher> publisher;
+};
 
-  m_running = true;
-  m_packetsSent = 0;
-  m_socket->Bind ();
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
+BranchState branchState;
 
-void
-MyApp::StopApplication (void)
+// Job body of a what-if branch, in a process forked at the checkpoint:
+// apply variant i, run to the end and write tput-time-<i>.plotme
+static std::string
+RunBranch (uint32_t index)
 {
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
+  const BranchState &s = branchState;
+  for (uint32_t i = 0; i < s.variants[index].size (); i++)
     {
-      Simulator::Cancel (m_sendEvent);
+      const std::string &name = s.variants[index][i].first;
+      const std::string &value = s.variants[index][i].second;
+      if (name == "rate")
+        {
+          for (uint32_t d = 0; d < s.bottleneck.GetN (); d++)
+            {
+              s.bottleneck.Get (d)->SetAttribute ("DataRate", DataRateValue (DataRate (value)));
+            }
+        }
+      else if (name == "queue")
+        {
+          NS_ABORT_MSG_UNLESS (s.bottleneckQueue->SetMaxSize (QueueSize (value)), "Cannot set the bottleneck queue size to " << value);
+        }
+      else if (name == "video")
+        {
+          Ptr<MmapTraceClient> mmapClient = DynamicCast<MmapTraceClient> (s.video);
+          if (mmapClient)
+            {
+              mmapClient->SetTrace (Create<VideoTrace> (value));
+            }
+          else
+            {
+              DynamicCast<UdpTraceClient> (s.video)->SetTraceFile (value);
+            }
+        }
+      else
+        {
+          NS_ABORT_MSG ("Unknown change " << name << " (rate, queue, video)");
+        }
     }
-
-  if (m_socket)
+  if (s.publisher)
     {
-      m_socket->Close ();
+      s.publisher->Reopen ("tcp-performance2 " + s.labels[index]);
     }
-}
-
-void
-MyApp::SendPacket (void)
-{
 
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
+  Simulator::Run ();
 
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
+  std::ostringstream tputFile;
+  tputFile << "tput-time-" << index << ".plotme";
+  s.aggregator->Write (tputFile.str ());
+  std::ostringstream result;
+  result << s.labels[index] << ": stopped at " << Simulator::Now ().GetSeconds () << " s,"
+         << " TCP goodput " << s.sink->GetTotalRx () * 8.0 / Simulator::Now ().GetSeconds () << " bps,"
+         << " video packets " << s.server->GetReceived ();
+  Simulator::Destroy ();
+  return result.str ();
 }
 
-void
-MyApp::ScheduleTx (void)
+// Main function
+int main (int argc, char *argv[])
 {
-  if (m_running)
+  RunStats runStats;
+  uint64_t allocations = AllocationCounter::Get ();
+  bool packetPool = false;
+  uint32_t burst = 1;
+  bool printStats = false;
+  bool steadyState = false;
+  double ssInterval = 0.1;
+  double ssPrecision = 0.05;
+  double tputWindow = 0.5;
+  std::string pcapMode = "all";
+  std::string scheduler = "map";
+  std::string profile;
+  std::string pcapDevices = "d4d5";
+  uint32_t snapLen = 0;
+  double pcapStart = 0;
+  double pcapStop = 200;
+  uint64_t pcapMaxBytes = 0;
+  std::string videoTrace = "starwars.dat";
+  std::string traceLoader = "text";
+  std::string live;
+  double liveInterval = 0.1;
+  std::string branches;
+  double branchAt = 10;
+  uint32_t jobs = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("packetPool", "Draw MyApp packets from a recycled pool", packetPool);
+  cmd.AddValue ("burst", "Packets MyApp sends per timer event, at the same average rate", burst);
+  cmd.AddValue ("printStats", "Print packets created and reused by MyApp, heap allocations, events per second, wall time and peak RSS", printStats);
+  cmd.AddValue ("steadyState", "Stop once the TCP and video goodput have reached steady state", steadyState);
+  cmd.AddValue ("ssInterval", "Goodput sampling interval of the steady-state test in seconds", ssInterval);
+  cmd.AddValue ("ssPrecision", "Largest 95% confidence half-width of the steady-state test, relative to the mean goodput", ssPrecision);
+  cmd.AddValue ("tputWindow", "Window of the throughput-vs-time series in tput-time.plotme, in seconds (at least 0.001)", tputWindow);
+  cmd.AddValue ("pcap", "Packet capture: all (every device, whole packets), selective or none", pcapMode);
+  cmd.AddValue ("pcapDevices", "Selective capture: comma-separated links to capture (d0d4, d1d4, d2d5, d3d5, d4d5)", pcapDevices);
+  cmd.AddValue ("snapLen", "Selective capture: bytes kept per packet (0 = whole packet)", snapLen);
+  cmd.AddValue ("pcapStart", "Selective capture: start time in seconds", pcapStart);
+  cmd.AddValue ("pcapStop", "Selective capture: stop time in seconds", pcapStop);
+  cmd.AddValue ("pcapMaxBytes", "Selective capture: size cap of one pcap file before rotating (0 = no rotation)", pcapMaxBytes);
+  cmd.AddValue ("videoTrace", "MPEG4 frame trace sent by the video source", videoTrace);
+  cmd.AddValue ("traceLoader", "Video trace loader: text (UdpTraceClient) or mmap (binary trace shared through the page cache)", traceLoader);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar, priority or timerwheel", scheduler);
+  cmd.AddValue ("profile", "Profile wall time per event type into <profile>.txt and <profile>.folded", profile);
+  cmd.AddValue ("live", "Publish progress to the shared-memory segment <live>.<pid>.<run>, shown by live-metrics-reader", live);
+  cmd.AddValue ("liveInterval", "Simulated seconds between live-metrics updates", liveInterval);
+  cmd.AddValue ("branches", "What-if variants run from the checkpoint, e.g. \"rate=2Mbps;queue=20p;video=other.dat\": semicolon-separated, each a comma-separated list of rate (bottleneck), queue (bottleneck queue size) or video (trace) changes; an empty variant changes nothing", branches);
+  cmd.AddValue ("branchAt", "Checkpoint time in seconds from which the branches are forked", branchAt);
+  cmd.AddValue ("jobs", "Number of branches run in parallel (0 = one per core)", jobs);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (!branches.empty () && pcapMode != "none", "Branches need --pcap=none, or every branch would write the same capture files");
+  // 200 s of 1 ms windows is 200000 counters per flow
+  NS_ABORT_MSG_UNLESS (tputWindow >= 0.001, "--tputWindow must be at least 0.001 s");
+  SelectScheduler (scheduler);
+  if (!profile.empty ())
     {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
+      ProfilingScheduler::Enable (profile);
     }
-}
 
-// Main function
-int main (int argc, char *argv[])
-{
   // Delay and data rate of bottleneck link
   std::string lat2 = "3ms";
   std::string rate2 = "1Mbps";
@@ -232,6 +279,8 @@ int main (int argc, char *argv[])
   // TCP source application at node 0
   Ptr<MyApp> app = CreateObject<MyApp> ();
   app->Setup (ns3TcpSocket, sinkAddress, 512, 1000000, DataRate ("10Mbps"));
+  app->SetPacketPool (packetPool);
+  app->SetBurst (burst);
   c.Get (0)->AddApplication (app);
   app->SetStartTime (Seconds (0.));
   app->SetStopTime (Seconds (200.));
@@ -239,28 +288,148 @@ int main (int argc, char *argv[])
   // Udp server application on node 3
   uint16_t port = 6;
   UdpServerHelper server (port);
-  ApplicationContainer apps = server.Install (c.Get (3));
-  apps.Start (Seconds (0.));
-  apps.Stop (Seconds (200.));
+  ApplicationContainer serverApps = server.Install (c.Get (3));
+  serverApps.Start (Seconds (0.));
+  serverApps.Stop (Seconds (200.));
 
   // Udp trace application on node 1 which sends packets from the trace file of a MPEG4 stream
   Address serverAddress (InetSocketAddress (i3i5.GetAddress (0), port));
   uint32_t MaxPacketSize = 512;
-  UdpTraceClientHelper client (serverAddress, port,"starwars.dat");
-  client.SetAttribute ("MaxPacketSize", UintegerValue (MaxPacketSize));
-  apps = client.Install (c.Get (1));
+  ApplicationContainer apps;
+  if (traceLoader == "mmap")
+    {
+      Ptr<MmapTraceClient> client = CreateObject<MmapTraceClient> ();
+      client->Setup (serverAddress, Create<VideoTrace> (videoTrace), MaxPacketSize);
+      c.Get (1)->AddApplication (client);
+      apps.Add (client);
+    }
+  else
+    {
+      NS_ABORT_MSG_UNLESS (traceLoader == "text", "Unknown trace loader " << traceLoader);
+      UdpTraceClientHelper client (serverAddress, port, videoTrace);
+      client.SetAttribute ("MaxPacketSize", UintegerValue (MaxPacketSize));
+      apps = client.Install (c.Get (1));
+    }
   apps.Start (Seconds (10.));
   apps.Stop (Seconds (200.));
 
   Simulator::Stop (Seconds (200.0));
 
+  // Throughput vs time of the TCP flow (column 2) and the video (column 3)
+  Ptr<ThroughputAggregator> aggregator = Create<ThroughputAggregator> (Seconds (tputWindow), Seconds (200.0), 2);
+  sinkApps.Get (0)->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&ThroughputAggregator::PacketSinkRx, aggregator, 0));
+  serverApps.Get (0)->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&ThroughputAggregator::UdpServerRx, aggregator, 1));
+
+  // Progress, bottleneck queue and received bytes of the TCP flow and the video
+  Ptr<QueueDisc> bottleneck = c.Get (4)->GetObject<TrafficControlLayer> ()->GetRootQueueDiscOnDevice (d4d5.Get (0));
+  Ptr<LiveMetricsPublisher> publisher;
+  if (!live.empty ())
+    {
+      publisher = Create<LiveMetricsPublisher> (live, "tcp-performance2", Seconds (liveInterval));
+      publisher->SetQueue (MakeCallback (&QueueDisc::GetNPackets, bottleneck));
+      publisher->AddFlow (MakeCallback (&PacketSink::GetTotalRx, DynamicCast<PacketSink> (sinkApps.Get (0))));
+      publisher->AddFlow (MakeBoundCallback (&VideoBytes, aggregator));
+    }
+
+  // Stop early once both flows have settled; sampling starts when the
+  // video stream is on
+  Ptr<SteadyStateMonitor> monitor;
+  if (steadyState)
+    {
+      monitor = Create<SteadyStateMonitor> (Seconds (ssInterval), 5, 5, ssPrecision);
+      monitor->AddFlow (MakeCallback (&PacketSink::GetTotalRx, DynamicCast<PacketSink> (sinkApps.Get (0))));
+      monitor->AddFlow (MakeCallback (&UdpServer::GetReceived, DynamicCast<UdpServer> (serverApps.Get (0))));
+      monitor->Start (Seconds (10.));
+    }
+
   // Enable pcap files
-  p2p.EnablePcapAll ("q");
+  if (pcapMode == "all")
+    {
+      p2p.EnablePcapAll ("q");
+    }
+  else if (pcapMode == "selective")
+    {
+      std::map<std::string, NetDeviceContainer> links;
+      links["d0d4"] = d0d4;
+      links["d1d4"] = d1d4;
+      links["d2d5"] = d2d5;
+      links["d3d5"] = d3d5;
+      links["d4d5"] = d4d5;
+
+      std::istringstream names (pcapDevices);
+      std::string name;
+      while (std::getline (names, name, ','))
+        {
+          NS_ABORT_MSG_UNLESS (links.count (name), "Unknown link " << name);
+          for (uint32_t i = 0; i < links[name].GetN (); i++)
+            {
+              Create<PcapCapture> ("q-" + name, links[name].Get (i), snapLen,
+                                   Seconds (pcapStart), Seconds (pcapStop), pcapMaxBytes);
+            }
+        }
+    }
+  else
+    {
+      NS_ABORT_MSG_UNLESS (pcapMode == "none", "Unknown pcap mode " << pcapMode);
+    }
+
+  // Run once to the checkpoint, then every variant from there in its own process
+  if (!branches.empty ())
+    {
+      branchState.variants = BranchRunner::ParseVariants (branches);
+      std::istringstream labels (branches);
+      std::string label;
+      while (std::getline (labels, label, ';'))
+        {
+          branchState.labels.push_back (label.empty () ? "unchanged" : label);
+        }
+      branchState.bottleneck = d4d5;
+      branchState.bottleneckQueue = bottleneck;
+      branchState.video = apps.Get (0);
+      branchState.sink = DynamicCast<PacketSink> (sinkApps.Get (0));
+      branchState.server = DynamicCast<UdpServer> (serverApps.Get (0));
+      branchState.aggregator = aggregator;
+      branchState.publisher = publisher;
+
+      BranchRunner runner (jobs);
+      std::vector<std::string> results = runner.Run (Seconds (branchAt), branchState.variants.size (), MakeCallback (&RunBranch));
+      std::cout << "checkpoint " << branchAt << " s reached in " << runner.GetPrefixSeconds () << " s wall" << std::endl;
+      for (uint32_t i = 0; i < results.size (); i++)
+        {
+          std::cout << "branch " << i << " " << results[i] << std::endl;
+        }
+      branchState = BranchState ();
+      Simulator::Destroy ();
+      return 0;
+    }
 
   // Run the simulation
   NS_LOG_INFO ("Run Simulation.");
   Simulator::Run ();
 
+  aggregator->Write ("tput-time.plotme");
+
+  if (monitor)
+    {
+      std::cout << "Stopped at " << Simulator::Now ().GetSeconds () << " s (" << monitor->GetStopReason () << "):"
+                << " TCP goodput " << DynamicCast<PacketSink> (sinkApps.Get (0))->GetTotalRx () * 8.0 / Simulator::Now ().GetSeconds () << " bps,"
+                << " video packets " << DynamicCast<UdpServer> (serverApps.Get (0))->GetReceived () << std::endl;
+    }
+
+  if (printStats)
+    {
+      double wall = runStats.GetWallSeconds ();
+      std::cout << "packets " << app->GetPacketsSent ()
+                << " created " << app->GetPacketsAllocated ()
+                << " poolHits " << app->GetPoolHits ()
+                << " allocs " << AllocationCounter::Get () - allocations
+                << " allocs/s " << (AllocationCounter::Get () - allocations) / wall
+                << " events " << Simulator::GetEventCount ()
+                << " events/s " << Simulator::GetEventCount () / wall
+                << " wall " << wall << " s"
+                << " peakRss " << RunStats::GetPeakRssKb () << " kB" << std::endl;
+    }
+
   // Release resources at the end of simulation
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef THROUGHPUT_AGGREGATOR_H
+#define THROUGHPUT_AGGREGATOR_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * Received bytes per flow in fixed time windows.
+ *
+ * The counters live in one flat array indexed by window * flows + flow,
+ * so a trace sink only increments one counter and the series is written
+ * in a single pass at the end of the run.  Received bytes beyond the
+ * configured duration are counted in the last window.
+ */
+class ThroughputAggregator : public SimpleRefCount<ThroughputAggregator>
+{
+public:
+  /**
+   * \param window width of a time window, positive
+   * \param duration simulated time covered by the series
+   * \param flows number of flows
+   */
+  ThroughputAggregator (Time window, Time duration, uint32_t flows)
+    : m_window (window),
+      m_flows (flows)
+  {
+    NS_ABORT_MSG_UNLESS (window.GetTimeStep () > 0, "Throughput window must be positive");
+    m_windows = static_cast<uint32_t> (duration.GetTimeStep () / window.GetTimeStep ()) + 1;
+    m_bytes.assign (static_cast<size_t> (m_windows) * m_flows, 0);
+    m_totals.assign (m_flows, 0);
+  }
+
+  /// Count bytes received by a flow now
+  void Add (uint32_t flow, uint32_t bytes)
+  {
+    uint64_t w = Simulator::Now ().GetTimeStep () / m_window.GetTimeStep ();
+    if (w >= m_windows)
+      {
+        w = m_windows - 1;
+      }
+    m_bytes[w * m_flows + flow] += bytes;
+    m_totals[flow] += bytes;
+  }
+
+  /// Bytes a flow has received so far
+  uint64_t GetTotalBytes (uint32_t flow) const
+  {
+    return m_totals[flow];
+  }
+
+  /// PacketSink "Rx" trace sink
+  static void PacketSinkRx (Ptr<ThroughputAggregator> aggregator, uint32_t flow,
+                            Ptr<const Packet> packet, const Address &from)
+  {
+    aggregator->Add (flow, packet->GetSize ());
+  }
+
+  /// UdpServer "Rx" trace sink
+  static void UdpServerRx (Ptr<ThroughputAggregator> aggregator, uint32_t flow,
+                           Ptr<const Packet> packet)
+  {
+    aggregator->Add (flow, packet->GetSize ());
+  }
+
+  /**
+   * Write one line per window up to the current simulation time: the
+   * window end in seconds, then the throughput of each flow in Mbps.
+   */
+  void Write (std::string filename) const
+  {
+    std::FILE *f = std::fopen (filename.c_str (), "w");
+    NS_ABORT_MSG_UNLESS (f, "Cannot open " << filename);
+    uint64_t last = Simulator::Now ().GetTimeStep () / m_window.GetTimeStep ();
+    double seconds = m_window.GetSeconds ();
+    for (uint64_t w = 0; w < m_windows && w <= last; w++)
+      {
+        std::fprintf (f, "%g", (w + 1) * seconds);
+        for (uint32_t flow = 0; flow < m_flows; flow++)
+          {
+            std::fprintf (f, "\t%g", m_bytes[w * m_flows + flow] * 8.0 / seconds / 1e6);
+          }
+        std::fputc ('\n', f);
+      }
+    std::fclose (f);
+  }
+
+private:
+  Time m_window;
+  uint32_t m_flows;
+  uint32_t m_windows;
+  std::vector<uint64_t> m_bytes;
+  std::vector<uint64_t> m_totals;
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_AGGREGATOR_H */
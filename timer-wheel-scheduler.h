@@ -0,0 +1,316 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef TIMER_WHEEL_SCHEDULER_H
+#define TIMER_WHEEL_SCHEDULER_H
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+#include "ns3/scheduler.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/type-id.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/**
+ * Event scheduler for many short, periodic timers.
+ *
+ * Events due within SlotCount * SlotWidth of the earliest pending event
+ * sit in a wheel of slots, one per SlotWidth; each slot is a small binary
+ * heap, so events keep the exact (time, uid) order of the other
+ * schedulers.  Packet transmissions, pacing timers and link delays land
+ * in the wheel, where an insert only touches one short heap.  Later
+ * events, such as retransmission timeouts, wait in an overflow heap and
+ * move into the wheel as it turns.
+ *
+ * The first pending slot is cached, and found through a bitmap of the
+ * non-empty slots when it has to be looked up again, so a sparse wheel
+ * costs a scan of SlotCount / 64 words at worst rather than of every
+ * slot.
+ */
+class TimerWheelScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::TimerWheelScheduler")
+      .SetParent<Scheduler> ()
+      .SetGroupName ("Core")
+      .AddConstructor<TimerWheelScheduler> ()
+      .AddAttribute ("SlotCount", "Number of slots in the wheel, rounded up to a power of two",
+                     UintegerValue (4096),
+                     MakeUintegerAccessor (&TimerWheelScheduler::m_slotCount),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("SlotWidth", "Simulated time covered by one slot",
+                     TimeValue (NanoSeconds (4096)),
+                     MakeTimeAccessor (&TimerWheelScheduler::m_slotWidth),
+                     MakeTimeChecker ())
+    ;
+    return tid;
+  }
+
+  TimerWheelScheduler ()
+    : m_slotCount (4096),
+      m_width (0),
+      m_mask (0),
+      m_base (0),
+      m_wheelEvents (0),
+      m_first (0),
+      m_firstValid (false)
+  {
+  }
+
+  virtual void Insert (const Event &ev)
+  {
+    Init ();
+    uint64_t slot = SlotOf (ev);
+    if (slot < m_base + m_slots.size ())
+      {
+        AddToSlot (slot, ev);
+      }
+    else
+      {
+        m_overflow.push_back (ev);
+        std::push_heap (m_overflow.begin (), m_overflow.end (), Later);
+      }
+  }
+
+  virtual bool IsEmpty (void) const
+  {
+    return m_wheelEvents == 0 && m_overflow.empty ();
+  }
+
+  virtual Event PeekNext (void) const
+  {
+    if (m_wheelEvents == 0)
+      {
+        return m_overflow.front ();
+      }
+    return m_slots[FirstSlot () & m_mask].front ();
+  }
+
+  virtual Event RemoveNext (void)
+  {
+    Event ev;
+    if (m_wheelEvents == 0)
+      {
+        ev = m_overflow.front ();
+        std::pop_heap (m_overflow.begin (), m_overflow.end (), Later);
+        m_overflow.pop_back ();
+        Turn (ev.key.m_ts / m_width);
+        return ev;
+      }
+    uint64_t slot = FirstSlot ();
+    std::vector<Event> &heap = m_slots[slot & m_mask];
+    ev = heap.front ();
+    std::pop_heap (heap.begin (), heap.end (), Later);
+    heap.pop_back ();
+    m_wheelEvents--;
+    if (heap.empty ())
+      {
+        Unmark (slot & m_mask);
+        m_firstValid = false;
+      }
+    Turn (slot);
+    return ev;
+  }
+
+  virtual void Remove (const Event &ev)
+  {
+    uint64_t slot = SlotOf (ev);
+    bool inWheel = slot < m_base + m_slots.size ();
+    std::vector<Event> &heap = inWheel ? m_slots[slot & m_mask] : m_overflow;
+    for (std::vector<Event>::iterator it = heap.begin (); it != heap.end (); ++it)
+      {
+        if (it->key.m_uid == ev.key.m_uid)
+          {
+            heap.erase (it);
+            std::make_heap (heap.begin (), heap.end (), Later);
+            if (inWheel)
+              {
+                m_wheelEvents--;
+                if (heap.empty ())
+                  {
+                    Unmark (slot & m_mask);
+                    m_firstValid = m_firstValid && slot != m_first;
+                  }
+              }
+            return;
+          }
+      }
+    NS_ABORT_MSG ("Event " << ev.key.m_uid << " is not scheduled");
+  }
+
+private:
+  // Min-heap order on (time, uid)
+  static bool Later (const Event &a, const Event &b)
+  {
+    return b < a;
+  }
+
+  void Init (void)
+  {
+    if (!m_slots.empty ())
+      {
+        return;
+      }
+    uint32_t slots = 1;
+    while (slots < m_slotCount)
+      {
+        slots <<= 1;
+      }
+    m_slots.resize (slots);
+    m_occupied.assign ((slots + 63) / 64, 0);
+    m_mask = slots - 1;
+    m_width = std::max<int64_t> (1, m_slotWidth.GetTimeStep ());
+  }
+
+  // Absolute slot number of an event.  Events are never scheduled
+  // before the current time, and the wheel never turns past it, but an
+  // earlier event would still be ordered correctly in the current slot.
+  uint64_t SlotOf (const Event &ev) const
+  {
+    return std::max (ev.key.m_ts / m_width, m_base);
+  }
+
+  void AddToSlot (uint64_t slot, const Event &ev)
+  {
+    std::vector<Event> &heap = m_slots[slot & m_mask];
+    heap.push_back (ev);
+    std::push_heap (heap.begin (), heap.end (), Later);
+    m_wheelEvents++;
+    Mark (slot & m_mask);
+    if (m_firstValid && slot < m_first)
+      {
+        m_first = slot;
+      }
+  }
+
+  void Mark (uint64_t index)
+  {
+    m_occupied[index >> 6] |= uint64_t (1) << (index & 63);
+  }
+
+  void Unmark (uint64_t index)
+  {
+    m_occupied[index >> 6] &= ~(uint64_t (1) << (index & 63));
+  }
+
+  // First non-empty slot; only called while the wheel holds events.  The
+  // wheel covers slots m_base .. m_base + size - 1, so the search starts
+  // at the index of m_base and wraps around once.
+  uint64_t FirstSlot (void) const
+  {
+    if (m_firstValid)
+      {
+        return m_first;
+      }
+    uint64_t start = m_base & m_mask;
+    uint64_t words = m_occupied.size ();
+    uint64_t word = start >> 6;
+    uint64_t bits = m_occupied[word] & (~uint64_t (0) << (start & 63));
+    for (uint64_t i = 0; bits == 0; i++)
+      {
+        NS_ASSERT (i < words);
+        word = (word + 1) % words;
+        bits = m_occupied[word];
+        if (word == start >> 6)
+          {
+            // Back at the first word: only the slots before start remain
+            bits &= ~(~uint64_t (0) << (start & 63));
+          }
+      }
+    uint64_t index = (word << 6) + __builtin_ctzll (bits);
+    m_first = m_base + ((index - start) & m_mask);
+    m_firstValid = true;
+    return m_first;
+  }
+
+  // Make slot the first slot of the wheel and pull in the overflow
+  // events that now fall within it
+  void Turn (uint64_t slot)
+  {
+    if (slot <= m_base)
+      {
+        return;
+      }
+    m_base = slot;
+    m_firstValid = m_firstValid && m_first >= m_base;
+    while (!m_overflow.empty () && m_overflow.front ().key.m_ts / m_width < m_base + m_slots.size ())
+      {
+        Event ev = m_overflow.front ();
+        std::pop_heap (m_overflow.begin (), m_overflow.end (), Later);
+        m_overflow.pop_back ();
+        AddToSlot (ev.key.m_ts / m_width, ev);
+      }
+  }
+
+  uint32_t m_slotCount;
+  Time m_slotWidth;
+  uint64_t m_width;                         //!< slot width in time steps
+  uint64_t m_mask;
+  uint64_t m_base;                          //!< absolute number of the first slot
+  uint64_t m_wheelEvents;
+  std::vector<std::vector<Event> > m_slots;
+  std::vector<uint64_t> m_occupied;         //!< bit i set when slot index i holds events
+  mutable uint64_t m_first;                 //!< cached first non-empty slot
+  mutable bool m_firstValid;
+  std::vector<Event> m_overflow;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TimerWheelScheduler);
+
+/**
+ * Make every simulator created from now on use the named event
+ * scheduler: map, heap, list, calendar, priority, timerwheel, or the
+ * name of any other Scheduler TypeId.
+ */
+inline void
+SelectScheduler (std::string name)
+{
+  if (name == "map" || name == "heap" || name == "list" || name == "calendar")
+    {
+      name = std::string ("ns3::") + char (std::toupper (name[0])) + name.substr (1) + "Scheduler";
+    }
+  else if (name == "priority")
+    {
+      name = "ns3::PriorityQueueScheduler";
+    }
+  else if (name == "timerwheel")
+    {
+      name = "ns3::TimerWheelScheduler";
+    }
+  TypeId tid;
+  NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (name, &tid) && tid.IsChildOf (Scheduler::GetTypeId ()),
+                       "Unknown scheduler " << name);
+  GlobalValue::Bind ("SchedulerType", TypeIdValue (tid));
+}
+
+} // namespace ns3
+
+#endif /* TIMER_WHEEL_SCHEDULER_H */
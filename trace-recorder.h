@@ -0,0 +1,247 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+#include "ns3/abort.h"
+#include "binary-trace.h"
+
+namespace ns3 {
+
+/**
+ * Buffered writer for (time, value) trace files.
+ *
+ * Trace sinks push fixed-size records into a ring buffer with Record ();
+ * a background thread drains the ring and writes the records to disk in
+ * large batches, so a sink never opens, flushes or closes the file.
+ * The ring has a fixed capacity: when the writer falls behind, Record ()
+ * waits for space instead of growing memory.
+ *
+ * A filename ending in .bintrace selects the columnar binary format of
+ * binary-trace.h instead of text; the writer thread does the encoding.
+ *
+ * There is a single producer (the simulation thread) and a single
+ * consumer (the writer thread).  Call CloseOnDestroy () to have the
+ * remaining records written when Simulator::Destroy () runs.
+ */
+class TraceRecorder : public SimpleRefCount<TraceRecorder>
+{
+public:
+  /**
+   * \param filename output file
+   * \param separator column separator written between time and value in text files
+   * \param append append to an existing file instead of truncating it
+   * \param capacity ring capacity in records, rounded up to a power of two
+   */
+  TraceRecorder (std::string filename, char separator = ' ', bool append = true,
+                 uint32_t capacity = 1 << 16)
+    : m_separator (separator),
+      m_head (0),
+      m_tail (0),
+      m_wake (false),
+      m_stop (false),
+      m_closed (false)
+  {
+    m_capacity = 1;
+    while (m_capacity < capacity)
+      {
+        m_capacity <<= 1;
+      }
+    m_mask = m_capacity - 1;
+    m_batch = m_capacity >= 8 ? m_capacity / 8 : 1;
+    m_ring.resize (m_capacity);
+
+    m_file = 0;
+    if (IsBinary (filename))
+      {
+        NS_ABORT_MSG_UNLESS (m_binary.Open (filename, 2, append), "Cannot open " << filename << " as a binary trace");
+      }
+    else
+      {
+        m_file = std::fopen (filename.c_str (), append ? "a" : "w");
+        NS_ABORT_MSG_UNLESS (m_file, "Cannot open " << filename << ": " << std::strerror (errno));
+      }
+    m_thread = std::thread (&TraceRecorder::WriterLoop, this);
+  }
+
+  ~TraceRecorder ()
+  {
+    Close ();
+  }
+
+  /// Queue one record for writing
+  void Record (double time, double value)
+  {
+    uint64_t head = m_head.load (std::memory_order_relaxed);
+    while (head - m_tail.load (std::memory_order_acquire) == m_capacity)
+      {
+        Wake ();
+        std::this_thread::yield ();
+      }
+    Entry &e = m_ring[head & m_mask];
+    e.time = time;
+    e.value = value;
+    m_head.store (head + 1, std::memory_order_release);
+    if (((head + 1) & (m_batch - 1)) == 0)
+      {
+        Wake ();
+      }
+  }
+
+  /// Queue one record stamped with the current simulation time
+  void Record (double value)
+  {
+    Record (Simulator::Now ().GetSeconds (), value);
+  }
+
+  /// Write every queued record and close the file
+  void Close (void)
+  {
+    if (m_closed)
+      {
+        return;
+      }
+    m_closed = true;
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_one ();
+    m_thread.join ();
+    if (m_file)
+      {
+        std::fclose (m_file);
+      }
+    m_binary.Close ();
+  }
+
+  /// Whether filename selects the binary format
+  static bool IsBinary (const std::string &filename)
+  {
+    const std::string suffix = ".bintrace";
+    return filename.size () >= suffix.size ()
+           && filename.compare (filename.size () - suffix.size (), suffix.size (), suffix) == 0;
+  }
+
+  /// Close the recorder from Simulator::Destroy ()
+  void CloseOnDestroy (void)
+  {
+    Simulator::ScheduleDestroy (&TraceRecorder::Close, Ptr<TraceRecorder> (this));
+  }
+
+private:
+  struct Entry
+  {
+    double time;
+    double value;
+  };
+
+  void Wake (void)
+  {
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_wake = true;
+    }
+    m_cv.notify_one ();
+  }
+
+  void WriterLoop (void)
+  {
+    bool stop = false;
+    while (!stop)
+      {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          m_cv.wait_for (lock, std::chrono::milliseconds (100),
+                         [this] { return m_wake || m_stop; });
+          m_wake = false;
+          stop = m_stop;
+        }
+        Drain ();
+      }
+  }
+
+  void Drain (void)
+  {
+    uint64_t tail = m_tail.load (std::memory_order_relaxed);
+    uint64_t head = m_head.load (std::memory_order_acquire);
+    if (!m_file)
+      {
+        for (; tail != head; tail++)
+          {
+            const Entry &e = m_ring[tail & m_mask];
+            double row[2] = { e.time, e.value };
+            m_binary.Add (row);
+            m_tail.store (tail + 1, std::memory_order_release);
+          }
+        return;
+      }
+    while (tail != head)
+      {
+        m_text.clear ();
+        for (; tail != head && m_text.size () < (1 << 20); tail++)
+          {
+            const Entry &e = m_ring[tail & m_mask];
+            char line[64];
+            int n = std::snprintf (line, sizeof (line), "%g%c%g\n", e.time, m_separator, e.value);
+            m_text.append (line, n);
+          }
+        // Hand the slots back before the (slow) write
+        m_tail.store (tail, std::memory_order_release);
+        std::fwrite (m_text.data (), 1, m_text.size (), m_file);
+        head = m_head.load (std::memory_order_acquire);
+      }
+  }
+
+  char m_separator;
+  uint32_t m_capacity;
+  uint32_t m_mask;
+  uint32_t m_batch;
+  std::vector<Entry> m_ring;
+  std::atomic<uint64_t> m_head;   //!< next slot written by the simulation
+  std::atomic<uint64_t> m_tail;   //!< next slot read by the writer thread
+  std::FILE *m_file;               //!< text output, or 0 for binary
+  BinaryTraceWriter m_binary;
+  std::string m_text;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_wake;
+  bool m_stop;
+  bool m_closed;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_RECORDER_H */
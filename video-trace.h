@@ -0,0 +1,293 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Aarti Nandagiri <aarti.nandagiri@gmail.com>
+ *          Mohit P. Tahiliani <tahiliani@nitk.edu.in>
+ */
+
+#ifndef VIDEO_TRACE_H
+#define VIDEO_TRACE_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/seq-ts-header.h"
+
+namespace ns3 {
+
+/**
+ * MPEG frame trace in a binary, memory-mapped form.
+ *
+ * The text trace read by UdpTraceClient ("index type time size" per
+ * line) is converted once into <trace>.vtb: a 16-byte header followed
+ * by one fixed-size record per frame, so the record of frame i is found
+ * at a fixed offset and the records double as the frame index.  The file
+ * is mapped read-only and shared, so concurrent simulations share the
+ * pages through the page cache and nothing is copied to the heap.
+ */
+class VideoTrace : public SimpleRefCount<VideoTrace>
+{
+public:
+  struct Frame
+  {
+    uint32_t time;        //!< frame time in ms
+    uint32_t timeToSend;  //!< delay after the previous frame in ms, as in UdpTraceClient
+    uint32_t size;        //!< frame size in bytes
+    uint32_t type;        //!< frame type character ('I', 'P' or 'B')
+  };
+
+  /// Map the binary form of a text trace, converting it first if needed
+  VideoTrace (std::string textTrace)
+    : m_base (0),
+      m_length (0)
+  {
+    std::string path = Convert (textTrace);
+    int fd = open (path.c_str (), O_RDONLY);
+    NS_ABORT_MSG_IF (fd < 0, "Cannot open " << path << ": " << std::strerror (errno));
+    struct stat st;
+    NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "Cannot stat " << path);
+    m_length = st.st_size;
+    NS_ABORT_MSG_IF (m_length < sizeof (Header), path << " is truncated");
+    void *base = mmap (0, m_length, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    NS_ABORT_MSG_IF (base == MAP_FAILED, "Cannot map " << path << ": " << std::strerror (errno));
+    madvise (base, m_length, MADV_SEQUENTIAL);
+    m_base = static_cast<const char *> (base);
+
+    const Header *header = reinterpret_cast<const Header *> (m_base);
+    NS_ABORT_MSG_UNLESS (std::memcmp (header->magic, "VTB1", 4) == 0, path << " is not a video trace");
+    NS_ABORT_MSG_UNLESS (sizeof (Header) + header->frames * sizeof (Frame) <= m_length, path << " is truncated");
+    m_frames = reinterpret_cast<const Frame *> (m_base + sizeof (Header));
+    m_count = header->frames;
+  }
+
+  ~VideoTrace ()
+  {
+    if (m_base)
+      {
+        munmap (const_cast<char *> (m_base), m_length);
+      }
+  }
+
+  uint64_t GetFrameCount (void) const
+  {
+    return m_count;
+  }
+
+  const Frame &GetFrame (uint64_t i) const
+  {
+    return m_frames[i];
+  }
+
+  /**
+   * Convert a text trace to <textTrace>.vtb unless an up-to-date binary
+   * exists.  The text is streamed, and the binary is written to a
+   * temporary file and renamed, so processes converting the same trace
+   * at the same time never see a partial file.
+   *
+   * \return the path of the binary trace
+   */
+  static std::string Convert (std::string textTrace)
+  {
+    std::string binary = textTrace + ".vtb";
+    struct stat textStat;
+    struct stat binaryStat;
+    NS_ABORT_MSG_IF (stat (textTrace.c_str (), &textStat) != 0, "Cannot open trace file " << textTrace);
+    if (stat (binary.c_str (), &binaryStat) == 0 && binaryStat.st_mtime >= textStat.st_mtime)
+      {
+        return binary;
+      }
+
+    std::ostringstream tmp;
+    tmp << binary << ".tmp." << getpid ();
+    std::FILE *out = std::fopen (tmp.str ().c_str (), "wb");
+    NS_ABORT_MSG_UNLESS (out, "Cannot create " << tmp.str ());
+
+    Header header;
+    std::memcpy (header.magic, "VTB1", 4);
+    header.version = 1;
+    header.frames = 0;
+    std::fwrite (&header, sizeof (header), 1, out);
+
+    std::ifstream in (textTrace.c_str ());
+    uint32_t index;
+    char frameType;
+    uint32_t time;
+    uint32_t size;
+    uint32_t prevTime = 0;
+    while (in >> index >> frameType >> time >> size)
+      {
+        Frame frame;
+        frame.time = time;
+        if (frameType == 'B')
+          {
+            frame.timeToSend = 0;
+          }
+        else
+          {
+            frame.timeToSend = time - prevTime;
+            prevTime = time;
+          }
+        frame.size = size;
+        frame.type = frameType;
+        std::fwrite (&frame, sizeof (frame), 1, out);
+        header.frames++;
+      }
+
+    std::rewind (out);
+    std::fwrite (&header, sizeof (header), 1, out);
+    NS_ABORT_MSG_IF (std::fclose (out) != 0, "Cannot write " << tmp.str ());
+    NS_ABORT_MSG_IF (std::rename (tmp.str ().c_str (), binary.c_str ()) != 0, "Cannot rename " << tmp.str ());
+    return binary;
+  }
+
+private:
+  struct Header
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t frames;
+  };
+
+  const char *m_base;
+  size_t m_length;
+  const Frame *m_frames;
+  uint64_t m_count;
+};
+
+/**
+ * UDP video source driven by a memory-mapped VideoTrace.
+ *
+ * Sends the same packets at the same times as UdpTraceClient: every
+ * frame is split into MaxPacketSize chunks carrying a SeqTsHeader, and
+ * B frames go out together with the preceding frame.
+ */
+class MmapTraceClient : public Application
+{
+public:
+  MmapTraceClient ()
+    : m_maxPacketSize (1024),
+      m_currentFrame (0),
+      m_sent (0)
+  {
+  }
+
+  void Setup (Address peer, Ptr<VideoTrace> trace, uint32_t maxPacketSize)
+  {
+    m_peer = peer;
+    m_trace = trace;
+    m_maxPacketSize = maxPacketSize;
+  }
+
+  /// Send frames of trace from now on, starting with its first frame
+  void SetTrace (Ptr<VideoTrace> trace)
+  {
+    NS_ABORT_MSG_IF (m_sendEvent.IsRunning () && trace->GetFrameCount () == 0, "Cannot switch a running client to an empty trace");
+    m_trace = trace;
+    m_currentFrame = 0;
+  }
+
+  /// Number of packets sent
+  uint32_t GetSent (void) const
+  {
+    return m_sent;
+  }
+
+private:
+  virtual void StartApplication (void)
+  {
+    m_socket = Socket::CreateSocket (GetNode (), UdpSocketFactory::GetTypeId ());
+    m_socket->Bind ();
+    m_socket->Connect (m_peer);
+    m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+    if (m_trace->GetFrameCount () > 0)
+      {
+        m_sendEvent = Simulator::ScheduleNow (&MmapTraceClient::Send, this);
+      }
+  }
+
+  virtual void StopApplication (void)
+  {
+    Simulator::Cancel (m_sendEvent);
+    if (m_socket)
+      {
+        m_socket->Close ();
+        m_socket = 0;
+      }
+  }
+
+  virtual void DoDispose (void)
+  {
+    m_trace = 0;
+    Application::DoDispose ();
+  }
+
+  void SendPacket (uint32_t size)
+  {
+    // The SeqTsHeader counts towards the packet size
+    uint32_t payload = size > 12 ? size - 12 : 0;
+    Ptr<Packet> p = Create<Packet> (payload);
+    SeqTsHeader seqTs;
+    seqTs.SetSeq (m_sent);
+    p->AddHeader (seqTs);
+    if (m_socket->Send (p) >= 0)
+      {
+        m_sent++;
+      }
+  }
+
+  void Send (void)
+  {
+    uint64_t count = m_trace->GetFrameCount ();
+    const VideoTrace::Frame *frame = &m_trace->GetFrame (m_currentFrame);
+    uint64_t frames = 0;
+    do
+      {
+        for (uint32_t i = 0; i < frame->size / m_maxPacketSize; i++)
+          {
+            SendPacket (m_maxPacketSize);
+          }
+        SendPacket (frame->size % m_maxPacketSize);
+        m_currentFrame = (m_currentFrame + 1) % count;
+        frame = &m_trace->GetFrame (m_currentFrame);
+      }
+    while (frame->timeToSend == 0 && ++frames < count);
+    m_sendEvent = Simulator::Schedule (MilliSeconds (frame->timeToSend), &MmapTraceClient::Send, this);
+  }
+
+  Ptr<Socket> m_socket;
+  Address m_peer;
+  Ptr<VideoTrace> m_trace;
+  uint32_t m_maxPacketSize;
+  uint64_t m_currentFrame;
+  uint32_t m_sent;
+  EventId m_sendEvent;
+};
+
+} // namespace ns3
+
+#endif /* VIDEO_TRACE_H */
@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# Check that the memory of the short-flow workload stays flat as the
+# number of flows started grows.
+#
+# Run from the top of an ns-3 tree whose scratch/ directory holds these
+# examples.  Each run prints peakActiveFlows, peakSockets (the most TCP
+# sockets open at once on the leaves) and peak RSS for a longer run at
+# the same flow rate.  The script fails if the longest run has more than
+# twice the peakSockets of the shortest one.
+
+WAF=${WAF:-./waf}
+RATE=${RATE:-200}
+STOPTIMES=${STOPTIMES:-"30 60 120 240"}
+
+first=
+last=
+for t in $STOPTIMES
+do
+  echo "== REDvsFIFO, flowRate=$RATE, stopTime=$t"
+  out=$($WAF --run "scratch/REDvsFIFO --flowRate=$RATE --bulk=false --stopTime=$t --printStats") || exit 1
+  echo "$out"
+  last=$(echo "$out" | sed -n 's/.*peakSockets \([0-9]*\).*/\1/p' | sort -n | tail -n 1)
+  first=${first:-$last}
+done
+
+echo "peakSockets $first at the shortest run, $last at the longest"
+if [ -z "$last" ] || [ "$last" -gt $((2 * first)) ]
+then
+  echo "socket count grows with the run length"
+  exit 1
+fi